@@ -0,0 +1,357 @@
+//
+//  main.cpp
+//  bench
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+// Microbenchmarks of the prettysort kernels: every building block of
+// prettySort() is timed on its own, on generated frames of a few sizes and
+// at a few thresholds, so that a regression shows up in the kernel that
+// caused it.
+//
+//     fakeartist-bench [--sizes 480p,1080p,4k] [--thresholds 64,128,192]
+//                      [--kernels sortRow,sortCol...] [--pattern photo]
+//                      [--min-time 0.5] [--json]
+//                      [--sort-dispatch <file> | --sort-backend <name>]
+//
+// Frames come from SyntheticSource, the same ones on every machine. Sorting
+// kernels get a fresh copy of the frame before every iteration, outside of
+// the timing. Random walks are seeded the same way for every iteration.
+//
+// Reported per kernel, size and threshold: the median time of an iteration,
+// that time per pixel of the frame, and for the kernels that count them,
+// the segments sorted (or runs generated) per second. --json prints the
+// results as a JSON document on stdout instead of a table.
+//
+// The sorting kernels use std::sort for every segment unless told otherwise:
+// --sort-dispatch uses the table calibrated for this machine (calibrating it
+// first if the file doesn't exist, see sortdispatch.h), --sort-backend one
+// backend for segments of any length.
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "prettysort.h"
+#include "sortdispatch.h"
+#include "SyntheticSource.h"
+
+using namespace std;
+using namespace sf;
+
+struct Resolution
+{
+    string name;
+    Vector2u size;
+};
+
+struct Result
+{
+    string kernel;
+    string resolution;
+    Vector2u size;
+    int threshold;          // -1 for kernels that don't have one
+    size_t iterations;
+    double nanoseconds;     // median of an iteration
+    long segments;          // per iteration, -1 if not counted
+};
+
+// Everything a kernel works on, for one frame size and threshold
+struct Workload
+{
+    Vector2u size;
+    FloatRect rect;
+    int threshold;
+    vector<Uint32> original;
+    vector<Uint32> pixels;
+    vector<VectorPixels> diagonals;
+};
+
+struct Kernel
+{
+    string name;
+    bool usesThreshold;
+    bool sortsPixels;
+    function<long(Workload&)> run;
+};
+
+static const unsigned RandomSeed = 0;
+static const size_t MinIterations = 3;
+static const size_t MaxIterations = 1000;
+
+static vector<Kernel> allKernels()
+{
+    vector<Kernel> kernels;
+
+    kernels.push_back({"getDiagonals", false, false, [](Workload& workload) {
+        return static_cast<long>(getDiagonals(workload.rect, 0.5f).size());
+    }});
+    kernels.push_back({"getManyCircles", false, false, [](Workload& workload) {
+        return static_cast<long>(getManyCircles(workload.rect, Vector2u(200, 200)).size());
+    }});
+    kernels.push_back({"getManySpirals", false, false, [](Workload& workload) {
+        return static_cast<long>(getManySpirals(workload.rect, Vector2u(400, 400)).size());
+    }});
+    kernels.push_back({"getRandomWalks", false, false, [](Workload& workload) {
+        srand(RandomSeed);
+        return static_cast<long>(getRandomWalks(workload.rect).size());
+    }});
+    kernels.push_back({"sortRow", true, true, [](Workload& workload) {
+        long segments = 0;
+        for (unsigned row = 0; row < workload.size.y; ++row)
+            segments += sortRow(&workload.pixels[0], workload.size, row, workload.threshold);
+        return segments;
+    }});
+    kernels.push_back({"sortCol", true, true, [](Workload& workload) {
+        long segments = 0;
+        for (unsigned column = 0; column < workload.size.x; ++column)
+            segments += sortCol(&workload.pixels[0], workload.size, column, workload.threshold);
+        return segments;
+    }});
+    kernels.push_back({"sortRuns", true, true, [](Workload& workload) {
+        return static_cast<long>(sortRuns(&workload.pixels[0], workload.size, workload.diagonals, workload.threshold));
+    }});
+    kernels.push_back({"prettySort", true, true, [](Workload& workload) {
+        State state;
+        state.mouseX = state.mouseY = workload.threshold / 255.0f;
+        state.time = 0;
+        prettySort(&workload.pixels[0], workload.size, state);
+        return -1L;
+    }});
+    kernels.push_back({"prettySort-all", true, true, [](Workload& workload) {
+        State state;
+        state.mouseX = state.mouseY = workload.threshold / 255.0f;
+        state.time = 0;
+        state.cols = state.rows = state.circles = state.spirals = state.random = true;
+        srand(RandomSeed);
+        prettySort(&workload.pixels[0], workload.size, state);
+        return -1L;
+    }});
+
+    return kernels;
+}
+
+static bool parseResolution(const string& name, Resolution& resolution)
+{
+    if (name == "480p") {
+        resolution = {name, Vector2u(854, 480)};
+    } else if (name == "720p") {
+        resolution = {name, Vector2u(1280, 720)};
+    } else if (name == "1080p") {
+        resolution = {name, Vector2u(1920, 1080)};
+    } else if (name == "4k") {
+        resolution = {name, Vector2u(3840, 2160)};
+    } else {
+        unsigned width = 0, height = 0;
+        if (sscanf(name.c_str(), "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+            return false;
+        resolution = {name, Vector2u(width, height)};
+    }
+    return true;
+}
+
+static vector<string> split(const string& list)
+{
+    vector<string> items;
+    istringstream stream(list);
+    string item;
+    while (getline(stream, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+static Result measure(const Kernel& kernel, Workload& workload, const string& resolution, double minSeconds)
+{
+    typedef chrono::steady_clock Clock;
+
+    vector<double> times;
+    long segments = 0;
+    Clock::time_point started = Clock::now();
+
+    while (times.size() < MinIterations
+           || (chrono::duration<double>(Clock::now() - started).count() < minSeconds && times.size() < MaxIterations)) {
+        if (kernel.sortsPixels)
+            workload.pixels = workload.original;
+
+        Clock::time_point start = Clock::now();
+        segments = kernel.run(workload);
+        times.push_back(chrono::duration<double, nano>(Clock::now() - start).count());
+    }
+
+    sort(times.begin(), times.end());
+    Result result = {kernel.name, resolution, workload.size, kernel.usesThreshold ? workload.threshold : -1,
+                     times.size(), times[times.size() / 2], segments};
+    return result;
+}
+
+static void printTable(const vector<Result>& results)
+{
+    printf("%-16s %-8s %9s %10s %12s %10s %14s\n", "kernel", "size", "threshold", "iterations", "ms/iteration", "ns/pixel", "segments/s");
+    for (const Result& result : results) {
+        double pixels = static_cast<double>(result.size.x) * result.size.y;
+        printf("%-16s %-8s %9s %10zu %12.3f %10.3f %14s\n", result.kernel.c_str(), result.resolution.c_str(),
+               result.threshold < 0 ? "-" : to_string(result.threshold).c_str(), result.iterations,
+               result.nanoseconds / 1e6, result.nanoseconds / pixels,
+               result.segments < 0 ? "-" : to_string(static_cast<long>(result.segments / (result.nanoseconds / 1e9))).c_str());
+    }
+}
+
+static void printJson(const vector<Result>& results, const string& pattern)
+{
+    printf("{\n  \"benchmark\": \"prettysort-kernels\",\n  \"pattern\": \"%s\",\n  \"results\": [\n", pattern.c_str());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        double pixels = static_cast<double>(result.size.x) * result.size.y;
+        printf("    {\"kernel\": \"%s\", \"size\": \"%s\", \"width\": %u, \"height\": %u, ",
+               result.kernel.c_str(), result.resolution.c_str(), result.size.x, result.size.y);
+        if (result.threshold < 0)
+            printf("\"threshold\": null, ");
+        else
+            printf("\"threshold\": %d, ", result.threshold);
+        printf("\"iterations\": %zu, \"ns_per_iteration\": %.0f, \"ns_per_pixel\": %.4f, ",
+               result.iterations, result.nanoseconds, result.nanoseconds / pixels);
+        if (result.segments < 0)
+            printf("\"segments\": null, \"segments_per_second\": null}");
+        else
+            printf("\"segments\": %ld, \"segments_per_second\": %.0f}", result.segments, result.segments / (result.nanoseconds / 1e9));
+        printf("%s\n", i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+static void printUsage()
+{
+    cerr << "usage: fakeartist-bench [options]" << endl
+         << "  --sizes <list>       480p, 720p, 1080p, 4k or WxH (default 480p,1080p,4k)" << endl
+         << "  --thresholds <list>  black values to sort at (default 64,128,192)" << endl
+         << "  --kernels <list>     kernels to time (default all of them)" << endl
+         << "  --pattern <name>     test pattern, see SyntheticSource.h (default photo)" << endl
+         << "  --min-time <s>       time spent on every measure at least (default 0.5)" << endl
+         << "  --json               print JSON instead of a table" << endl
+         << "  --sort-dispatch <path> sort segments with the calibrated table saved there" << endl
+         << "  --sort-backend <name> sort every segment with insertion, network, std::sort or radix" << endl;
+}
+
+int main(int argc, char const** argv)
+{
+    vector<string> sizeNames = split("480p,1080p,4k");
+    vector<string> thresholdNames = split("64,128,192");
+    vector<string> kernelNames;
+    string patternName = "photo";
+    double minSeconds = 0.5;
+    bool json = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        if (argument == "--sizes" && i + 1 < argc) {
+            sizeNames = split(argv[++i]);
+        } else if (argument == "--thresholds" && i + 1 < argc) {
+            thresholdNames = split(argv[++i]);
+        } else if (argument == "--kernels" && i + 1 < argc) {
+            kernelNames = split(argv[++i]);
+        } else if (argument == "--pattern" && i + 1 < argc) {
+            patternName = argv[++i];
+        } else if (argument == "--min-time" && i + 1 < argc) {
+            minSeconds = atof(argv[++i]);
+        } else if (argument == "--json") {
+            json = true;
+        } else if (argument == "--sort-dispatch" && i + 1 < argc) {
+            useSortDispatch(argv[++i]);
+        } else if (argument == "--sort-backend" && i + 1 < argc) {
+            SortDispatch dispatch;
+            if (!sortBackendFromName(argv[++i], dispatch.backends[0])) {
+                cerr << "Unknown sort backend " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+            fill(dispatch.backends, dispatch.backends + SegmentStats::HistogramBuckets, dispatch.backends[0]);
+            setSortDispatch(dispatch);
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    vector<Resolution> resolutions;
+    for (const string& name : sizeNames) {
+        Resolution resolution;
+        if (!parseResolution(name, resolution)) {
+            cerr << "Unknown size " << name << endl;
+            return EXIT_FAILURE;
+        }
+        resolutions.push_back(resolution);
+    }
+
+    vector<int> thresholds;
+    for (const string& name : thresholdNames)
+        thresholds.push_back(min(255, max(0, atoi(name.c_str()))));
+
+    SyntheticSource::Pattern pattern;
+    if (!SyntheticSource::patternFromName(patternName, pattern)) {
+        cerr << "Unknown pattern " << patternName << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<Kernel> kernels;
+    for (const Kernel& kernel : allKernels()) {
+        if (kernelNames.empty() || find(kernelNames.begin(), kernelNames.end(), kernel.name) != kernelNames.end())
+            kernels.push_back(kernel);
+    }
+    if (kernels.empty()) {
+        cerr << "No such kernels" << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<Result> results;
+    for (const Resolution& resolution : resolutions) {
+        SyntheticSource source(resolution.size, pattern);
+        FrameView frame;
+        if (!source.open() || !source.acquire(frame)) {
+            cerr << "Could not generate a " << resolution.name << " frame" << endl;
+            return EXIT_FAILURE;
+        }
+
+        Workload workload;
+        workload.size = resolution.size;
+        workload.rect = FloatRect(0, 0, resolution.size.x, resolution.size.y);
+        workload.original.resize(resolution.size.x * resolution.size.y);
+        memcpy(&workload.original[0], frame.pixels, workload.original.size() * 4);
+        workload.diagonals = getDiagonals(workload.rect, 0.5f);
+        source.release(frame);
+
+        for (const Kernel& kernel : kernels) {
+            if (!kernel.usesThreshold) {
+                workload.threshold = -1;
+                results.push_back(measure(kernel, workload, resolution.name, minSeconds));
+                if (!json)
+                    cerr << "." << flush;
+                continue;
+            }
+
+            for (int threshold : thresholds) {
+                workload.threshold = threshold;
+                results.push_back(measure(kernel, workload, resolution.name, minSeconds));
+                if (!json)
+                    cerr << "." << flush;
+            }
+        }
+    }
+
+    if (json) {
+        printJson(results, patternName);
+    } else {
+        cerr << endl;
+        printTable(results);
+    }
+    return EXIT_SUCCESS;
+}
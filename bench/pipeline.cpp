@@ -0,0 +1,455 @@
+//
+//  pipeline.cpp
+//  bench
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+// End to end benchmark of the movie pipeline: a clip is generated and
+// encoded with libavcodec at startup, then played back through sfeMovie's
+// demuxer and video stream, sorted and handed to a sink, frame after frame
+// as fast as the machine allows. No window nor texture is involved, so it
+// runs on a box without a display.
+//
+//     fakeartist-pipeline-bench [--size 720p] [--frames 300] [--pattern photo]
+//                               [--clip-codec h264] [--sink none] [--threshold 128]
+//                               [--all-passes] [--warmup 10] [--clip file.mp4] [--json]
+//                               [--trace trace.json]
+//
+// The clip comes from SyntheticSource, so every machine decodes the same
+// frames; with --clip it is kept in that file instead of a temporary one.
+//
+// Every frame goes through four stages, timed separately:
+//
+// decode  demuxing, decoding and converting to RGBA (VideoStream::decodeNextFrame)
+// copy    out of the decoder's buffer into the frame being sorted
+// sort    prettySort()
+// sink    writing the sorted frame: nothing with --sink none, encoding it
+//         again with --sink h264 or ffv1
+//
+// Reported: the sustained frame rate over the whole run, the latency of a
+// frame from the start of its decoding to the end of its writing (p50 and
+// p99), and the mean, p50 and p99 of every stage with its share of the
+// time. The first --warmup frames are played but left out of the numbers.
+// --trace writes the zones of the measured frames as a Chrome trace, see
+// Trace.hpp, for a finer split than the four stages.
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Demuxer.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+#include "FrameSink.h"
+#include "prettysort.h"
+#include "SortTracing.h"
+#include "SyntheticSource.h"
+#include "VideoFileSink.h"
+
+using namespace std;
+using namespace sf;
+
+typedef chrono::steady_clock BenchClock;
+
+enum Stage
+{
+    Decode,
+    Copy,
+    Sort,
+    Write,
+    StageCount
+};
+
+static const char* const StageNames[StageCount] = {"decode", "copy", "sort", "sink"};
+
+struct Options
+{
+    Vector2u size = Vector2u(1280, 720);
+    long frames = 300;
+    float frameRate = 30;
+    SyntheticSource::Pattern pattern = SyntheticSource::Photo;
+    string clipCodec = "h264";
+    string sink = "none";
+    int threshold = 128;
+    bool allPasses = false;
+    long warmup = 10;
+    string clipPath;
+    bool json = false;
+    string tracePath;
+};
+
+struct Distribution
+{
+    double mean;
+    double p50;
+    double p99;
+};
+
+// The decoded frames are taken with VideoStream::copyFrame(), the delegate
+// only has to stay out of the way
+class NullDelegate : public sfe::VideoStream::Delegate
+{
+public:
+    void didUpdateVideo(const sfe::VideoStream&, const Texture&)
+    {
+    }
+
+    bool usesVideoTexture() const
+    {
+        return false;
+    }
+};
+
+// Sink of --sink none, which leaves the decoder and the sorter alone on the clock
+class NullSink : public FrameSink
+{
+public:
+    bool begin(const Vector2u&)
+    {
+        return true;
+    }
+
+    bool write(const Uint8*, Time)
+    {
+        return true;
+    }
+
+    void end()
+    {
+    }
+
+    string getPath() const
+    {
+        return "";
+    }
+};
+
+// Removes the files of a run when it ends, successful or not. Declared
+// before what keeps them open, so that it goes last.
+struct TemporaryFiles
+{
+    vector<string> paths;
+
+    ~TemporaryFiles()
+    {
+        for (const string& path : paths)
+            remove(path.c_str());
+    }
+};
+
+static bool parseSize(const string& name, Vector2u& size)
+{
+    if (name == "480p") {
+        size = Vector2u(854, 480);
+    } else if (name == "720p") {
+        size = Vector2u(1280, 720);
+    } else if (name == "1080p") {
+        size = Vector2u(1920, 1080);
+    } else if (name == "4k") {
+        size = Vector2u(3840, 2160);
+    } else {
+        unsigned width = 0, height = 0;
+        if (sscanf(name.c_str(), "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+            return false;
+        size = Vector2u(width, height);
+    }
+    return true;
+}
+
+static string temporaryPath(const string& suffix)
+{
+    const char* directory = getenv("TMPDIR");
+    string path = directory && *directory ? directory : "/tmp";
+    if (path[path.size() - 1] != '/')
+        path += '/';
+    return path + "fakeartist-pipeline-" + to_string(getpid()) + suffix;
+}
+
+static double millisecondsSince(BenchClock::time_point start)
+{
+    return chrono::duration<double, milli>(BenchClock::now() - start).count();
+}
+
+static Distribution distribution(vector<double> values)
+{
+    Distribution result = {0, 0, 0};
+    if (values.empty())
+        return result;
+
+    sort(values.begin(), values.end());
+    for (double value : values)
+        result.mean += value;
+    result.mean /= values.size();
+    result.p50 = values[values.size() / 2];
+    result.p99 = values[min(values.size() - 1, values.size() * 99 / 100)];
+    return result;
+}
+
+// Encodes the test clip the benchmark plays back
+static bool encodeClip(const Options& options, const string& path)
+{
+    VideoFileSink::Codec codec = options.clipCodec == "ffv1" ? VideoFileSink::FFV1 : VideoFileSink::H264;
+    SyntheticSource source(options.size, options.pattern, options.frameRate);
+    VideoFileSink sink(path, codec);
+
+    if (!source.open() || !sink.begin(options.size))
+        return false;
+
+    bool ok = true;
+    for (long i = 0; ok && i < options.frames; ++i) {
+        FrameView frame;
+        if (!source.acquire(frame)) {
+            ok = false;
+            break;
+        }
+        ok = sink.write(frame.pixels, frame.timestamp);
+        source.release(frame);
+    }
+    sink.end();
+    return ok;
+}
+
+static unique_ptr<FrameSink> createSink(const Options& options, const string& path)
+{
+    if (options.sink == "h264")
+        return unique_ptr<FrameSink>(new VideoFileSink(path, VideoFileSink::H264));
+    if (options.sink == "ffv1")
+        return unique_ptr<FrameSink>(new VideoFileSink(path, VideoFileSink::FFV1));
+    return unique_ptr<FrameSink>(new NullSink());
+}
+
+static void printReport(const Options& options, const Vector2i& size, long frames, double seconds,
+                        const Distribution& latency, const Distribution* stages)
+{
+    double total = 0;
+    for (int stage = 0; stage < StageCount; ++stage)
+        total += stages[stage].mean;
+
+    if (options.json) {
+        printf("{\n  \"benchmark\": \"pipeline\",\n  \"pattern\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n",
+               SyntheticSource::getPatternName(options.pattern), size.x, size.y);
+        printf("  \"clip_codec\": \"%s\",\n  \"sink\": \"%s\",\n  \"threshold\": %d,\n  \"all_passes\": %s,\n",
+               options.clipCodec.c_str(), options.sink.c_str(), options.threshold, options.allPasses ? "true" : "false");
+        printf("  \"frames\": %ld,\n  \"seconds\": %.3f,\n  \"fps\": %.2f,\n", frames, seconds, seconds > 0 ? frames / seconds : 0);
+        printf("  \"latency_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f},\n", latency.mean, latency.p50, latency.p99);
+        printf("  \"stages_ms\": {\n");
+        for (int stage = 0; stage < StageCount; ++stage) {
+            printf("    \"%s\": {\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f}%s\n", StageNames[stage],
+                   stages[stage].mean, stages[stage].p50, stages[stage].p99, stage + 1 < StageCount ? "," : "");
+        }
+        printf("  }\n}\n");
+        return;
+    }
+
+    printf("%dx%d %s clip (%s), sink %s, threshold %d%s\n", size.x, size.y,
+           SyntheticSource::getPatternName(options.pattern), options.clipCodec.c_str(), options.sink.c_str(),
+           options.threshold, options.allPasses ? ", all passes" : "");
+    printf("%ld frames in %.2fs: %.1f fps\n", frames, seconds, seconds > 0 ? frames / seconds : 0);
+    printf("latency  p50 %.2fms  p99 %.2fms\n\n", latency.p50, latency.p99);
+    printf("%-8s %10s %10s %10s %8s\n", "stage", "mean ms", "p50 ms", "p99 ms", "share");
+    for (int stage = 0; stage < StageCount; ++stage) {
+        printf("%-8s %10.3f %10.3f %10.3f %7.1f%%\n", StageNames[stage], stages[stage].mean, stages[stage].p50,
+               stages[stage].p99, total > 0 ? 100 * stages[stage].mean / total : 0);
+    }
+}
+
+static void printUsage()
+{
+    cerr << "usage: fakeartist-pipeline-bench [options]" << endl
+         << "  --size <size>         480p, 720p, 1080p, 4k or WxH (default 720p)" << endl
+         << "  --frames <count>      length of the clip (default 300)" << endl
+         << "  --fps <rate>          frame rate of the clip (default 30)" << endl
+         << "  --pattern <name>      test pattern, see SyntheticSource.h (default photo)" << endl
+         << "  --clip-codec <codec>  h264 or ffv1, codec of the clip (default h264)" << endl
+         << "  --sink <sink>         none, h264 or ffv1, what sorted frames go to (default none)" << endl
+         << "  --threshold <value>   black value to sort at (default 128)" << endl
+         << "  --all-passes          sort rows, columns, circles, spirals and walks too" << endl
+         << "  --warmup <count>      frames left out of the numbers (default 10)" << endl
+         << "  --clip <file>         keep the clip in this file" << endl
+         << "  --json                print JSON instead of a report" << endl
+         << "  --trace <file>        write the zones of the measured frames as a Chrome trace" << endl;
+}
+
+int main(int argc, char const** argv)
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        if (argument == "--size" && i + 1 < argc) {
+            if (!parseSize(argv[++i], options.size)) {
+                cerr << "Unknown size " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--frames" && i + 1 < argc) {
+            options.frames = atol(argv[++i]);
+        } else if (argument == "--fps" && i + 1 < argc) {
+            options.frameRate = static_cast<float>(atof(argv[++i]));
+        } else if (argument == "--pattern" && i + 1 < argc) {
+            if (!SyntheticSource::patternFromName(argv[++i], options.pattern)) {
+                cerr << "Unknown pattern " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--clip-codec" && i + 1 < argc) {
+            options.clipCodec = argv[++i];
+        } else if (argument == "--sink" && i + 1 < argc) {
+            options.sink = argv[++i];
+        } else if (argument == "--threshold" && i + 1 < argc) {
+            options.threshold = min(255, max(0, atoi(argv[++i])));
+        } else if (argument == "--all-passes") {
+            options.allPasses = true;
+        } else if (argument == "--warmup" && i + 1 < argc) {
+            options.warmup = max(0L, atol(argv[++i]));
+        } else if (argument == "--clip" && i + 1 < argc) {
+            options.clipPath = argv[++i];
+        } else if (argument == "--json") {
+            options.json = true;
+        } else if (argument == "--trace" && i + 1 < argc) {
+            options.tracePath = argv[++i];
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.clipCodec != "h264" && options.clipCodec != "ffv1") {
+        cerr << "Unknown clip codec " << options.clipCodec << endl;
+        return EXIT_FAILURE;
+    }
+    if (options.sink != "none" && options.sink != "h264" && options.sink != "ffv1") {
+        cerr << "Unknown sink " << options.sink << endl;
+        return EXIT_FAILURE;
+    }
+    if (options.frames <= options.warmup || options.frameRate <= 0) {
+        cerr << "--frames must be more than --warmup, and --fps positive" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // FFV1 needs a container that can hold it
+    bool keepClip = !options.clipPath.empty();
+    string clipPath = keepClip ? options.clipPath : temporaryPath(options.clipCodec == "ffv1" ? "-clip.mkv" : "-clip.mp4");
+    string outputPath = temporaryPath(options.sink == "ffv1" ? "-output.mkv" : "-output.mp4");
+
+    TemporaryFiles temporaryFiles;
+    if (!keepClip)
+        temporaryFiles.paths.push_back(clipPath);
+    if (options.sink != "none")
+        temporaryFiles.paths.push_back(outputPath);
+
+    if (!options.json)
+        cerr << "Encoding " << options.frames << " frames to " << clipPath << endl;
+    if (!encodeClip(options, clipPath)) {
+        cerr << "Could not encode the clip to " << clipPath << endl;
+        return EXIT_FAILURE;
+    }
+
+    shared_ptr<sfe::Timer> timer = make_shared<sfe::Timer>();
+    NullDelegate delegate;
+    unique_ptr<sfe::Demuxer> demuxer;
+    try {
+        demuxer.reset(new sfe::Demuxer(clipPath, timer, delegate));
+    } catch (std::runtime_error& e) {
+        cerr << "Could not open " << clipPath << ": " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    demuxer->selectFirstVideoStream();
+    shared_ptr<sfe::VideoStream> stream = demuxer->getSelectedVideoStream();
+    if (!stream) {
+        cerr << "No video stream in " << clipPath << endl;
+        return EXIT_FAILURE;
+    }
+
+    Vector2i frameSize = stream->getFrameSize();
+    Vector2u size(frameSize.x, frameSize.y);
+    unique_ptr<FrameSink> sink = createSink(options, outputPath);
+    if (!sink->begin(size)) {
+        cerr << "Could not write " << outputPath << endl;
+        return EXIT_FAILURE;
+    }
+
+    vector<Uint32> pixels(size.x * size.y);
+    vector<double> latencies;
+    vector<double> stageTimes[StageCount];
+    long frameCount = 0;
+    bool ok = true;
+    BenchClock::time_point measureStart = BenchClock::now();
+
+    traceSortPasses();
+    srand(0);
+    while (ok) {
+        if (frameCount == options.warmup) {
+            measureStart = BenchClock::now();
+            sfe::Trace::setEnabled(!options.tracePath.empty());
+        }
+
+        double times[StageCount];
+        BenchClock::time_point frameStart = BenchClock::now();
+
+        BenchClock::time_point stageStart = frameStart;
+        if (!stream->decodeNextFrame())
+            break;
+        times[Decode] = millisecondsSince(stageStart);
+
+        stageStart = BenchClock::now();
+        stream->copyFrame(reinterpret_cast<Uint8*>(&pixels[0]));
+        times[Copy] = millisecondsSince(stageStart);
+
+        State state;
+        state.mouseX = state.mouseY = options.threshold / 255.0f;
+        state.time = frameCount / options.frameRate;
+        if (options.allPasses)
+            state.cols = state.rows = state.circles = state.spirals = state.random = true;
+
+        stageStart = BenchClock::now();
+        prettySort(&pixels[0], size, state);
+        times[Sort] = millisecondsSince(stageStart);
+
+        stageStart = BenchClock::now();
+        ok = sink->write(reinterpret_cast<const Uint8*>(&pixels[0]), seconds(state.time));
+        times[Write] = millisecondsSince(stageStart);
+
+        if (frameCount >= options.warmup) {
+            latencies.push_back(millisecondsSince(frameStart));
+            for (int stage = 0; stage < StageCount; ++stage)
+                stageTimes[stage].push_back(times[stage]);
+        }
+        frameCount++;
+    }
+
+    // Encoders hold frames back, flushing them is part of the run
+    sink->end();
+    double elapsed = chrono::duration<double>(BenchClock::now() - measureStart).count();
+    sfe::Trace::setEnabled(false);
+    if (!options.tracePath.empty() && !sfe::Trace::writeChromeTrace(options.tracePath))
+        cerr << "Could not write trace to " << options.tracePath << endl;
+
+    if (!ok) {
+        cerr << "Could not write " << outputPath << endl;
+        return EXIT_FAILURE;
+    }
+    if (frameCount != options.frames)
+        cerr << "Decoded " << frameCount << " frames out of the " << options.frames << " encoded" << endl;
+    if (latencies.empty()) {
+        cerr << "No frame left after the warmup" << endl;
+        return EXIT_FAILURE;
+    }
+
+    Distribution stages[StageCount];
+    for (int stage = 0; stage < StageCount; ++stage)
+        stages[stage] = distribution(stageTimes[stage]);
+
+    printReport(options, frameSize, static_cast<long>(latencies.size()), elapsed, distribution(latencies), stages);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+//
+//  AllocationCounter.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static atomic<unsigned long> allocationCount(0);
+
+static void* allocate(size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    return malloc(size > 0 ? size : 1);
+}
+
+unsigned long getAllocationCount()
+{
+    return allocationCount.load(memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+    void* pointer = allocate(size);
+    if (!pointer)
+        throw bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size)
+{
+    void* pointer = allocate(size);
+    if (!pointer)
+        throw bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void* pointer, const nothrow_t&) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, const nothrow_t&) noexcept
+{
+    free(pointer);
+}
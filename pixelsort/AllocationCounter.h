@@ -0,0 +1,17 @@
+//
+//  AllocationCounter.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_AllocationCounter_h
+#define pixelsort_AllocationCounter_h
+
+// Heap allocations made through operator new since the start, counted by
+// AllocationCounter.cpp replacing the global operators new and delete.
+// Only the app links it. FFmpeg and the system frameworks call malloc()
+// directly, their allocations aren't counted.
+unsigned long getAllocationCount();
+
+#endif
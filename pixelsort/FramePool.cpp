@@ -0,0 +1,77 @@
+//
+//  FramePool.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "FramePool.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace sf;
+
+FrameView::FrameView()
+    : pixels(nullptr)
+    , stride(0)
+    , format(Rgba)
+    , slot(0)
+{
+}
+
+FramePool::FramePool(size_t capacity_)
+    : capacity(max<size_t>(1, capacity_))
+{
+}
+
+bool FramePool::acquire(const Vector2u& size_, FrameView& frame)
+{
+    if (size_.x == 0 || size_.y == 0)
+        return false;
+
+    lock_guard<std::mutex> lock(mutex);
+
+    if (size_ != size) {
+        if (freeSlots.size() != buffers.size())
+            return false;
+
+        size = size_;
+        buffers.assign(capacity, vector<Uint8>(size.x * size.y * 4));
+        freeSlots.clear();
+        for (size_t slot = capacity; slot > 0; --slot)
+            freeSlots.push_back(slot - 1);
+    }
+
+    if (freeSlots.empty())
+        return false;
+
+    frame.slot = freeSlots.back();
+    freeSlots.pop_back();
+    frame.pixels = &buffers[frame.slot][0];
+    frame.size = size;
+    frame.stride = size.x * 4;
+    frame.format = FrameView::Rgba;
+    frame.timestamp = Time::Zero;
+    return true;
+}
+
+void FramePool::release(const FrameView& frame)
+{
+    lock_guard<std::mutex> lock(mutex);
+    // Views of older buffers, or released twice, are ignored
+    if (frame.slot < buffers.size() && frame.pixels == &buffers[frame.slot][0]
+        && find(freeSlots.begin(), freeSlots.end(), frame.slot) == freeSlots.end())
+        freeSlots.push_back(frame.slot);
+}
+
+size_t FramePool::getCapacity() const
+{
+    return capacity;
+}
+
+size_t FramePool::getAvailable() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    return size.x == 0 ? capacity : freeSlots.size();
+}
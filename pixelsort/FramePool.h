@@ -0,0 +1,62 @@
+//
+//  FramePool.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_FramePool_h
+#define pixelsort_FramePool_h
+
+#include <mutex>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+// A frame borrowed from a FramePool: writable pixels and what they hold.
+struct FrameView
+{
+    enum Format
+    {
+        // 4 bytes per pixel in R, G, B, A order, what sf::Image uses
+        Rgba
+    };
+
+    FrameView();
+
+    sf::Uint8* pixels;
+    sf::Vector2u size;
+    size_t stride;          // bytes from one row to the next
+    Format format;
+    sf::Time timestamp;
+    size_t slot;            // which pool buffer, for FramePool::release()
+};
+
+// Fixed set of frame buffers that are lent out and handed back, so that
+// producing frames doesn't allocate once the pool is warm.
+//
+// Buffers are tightly packed RGBA, stride is always size.x * 4. They are
+// allocated for the size of the first frame and reallocated when the size
+// changes, which only happens once every buffer was released.
+class FramePool
+{
+public:
+    explicit FramePool(size_t capacity = 3);
+
+    // Borrow a buffer for a frame of the given size. Returns false if every
+    // buffer is borrowed already, or if the size changed while some are.
+    bool acquire(const sf::Vector2u& size, FrameView& frame);
+    void release(const FrameView& frame);
+
+    size_t getCapacity() const;
+    size_t getAvailable() const;
+
+private:
+    size_t capacity;
+    sf::Vector2u size;
+    std::vector<std::vector<sf::Uint8>> buffers;
+    std::vector<size_t> freeSlots;
+    mutable std::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,125 @@
+//
+//  FrameProfile.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "FrameProfile.h"
+
+#include "AllocationCounter.h"
+#include "platform.h"
+#include "video/Trace.hpp"
+
+using namespace std;
+using namespace sf;
+
+FrameProfile::FrameProfile()
+    : queuedPackets(0)
+    , recorderQueue(0)
+    , skippedFrames(0)
+    , recorderDroppedFrames(0)
+    , allocations(0)
+    , residentMemory(0)
+{
+}
+
+FrameProfiler::FrameProfiler()
+    : enabled(false)
+    , movie(nullptr)
+    , decodedFrames(0)
+    , skippedFrames(0)
+    , allocations(0)
+{
+}
+
+void FrameProfiler::setEnabled(bool enabled_)
+{
+    if (enabled_ == enabled)
+        return;
+
+    enabled = enabled_;
+    sfe::Trace::setSummaryEnabled(enabled);
+
+    if (enabled) {
+        // Zones of the time we weren't looking would end up in the first frame
+        sfe::Trace::takeSummary();
+        last = FrameProfile();
+        sortStats = SortStats();
+        frameClock.restart();
+        movie = nullptr;
+        skippedFrames = 0;
+        allocations = getAllocationCount();
+    }
+}
+
+bool FrameProfiler::isEnabled() const
+{
+    return enabled;
+}
+
+SortStats* FrameProfiler::getSortStats()
+{
+    return enabled ? &sortStats : nullptr;
+}
+
+void FrameProfiler::endFrame(const sfe::Movie* movie_, const Recorder& recorder)
+{
+    if (!enabled)
+        return;
+
+    FrameProfile frame;
+    frame.total = frameClock.restart();
+
+    // Movies are decoded for display on the main thread, those preloading on
+    // the playlist loader thread decode too but that isn't frame work
+    static const vector<string> frameThreads = { "main" };
+
+    for (const sfe::Trace::ZoneTotal& zone : sfe::Trace::takeSummary(frameThreads)) {
+        Time duration = microseconds(zone.duration / 1000);
+        if (zone.name == "decode") {
+            frame.decode = duration;
+        } else if (zone.name == "sws_scale") {
+            frame.convert = duration;
+        } else if (zone.name == "texture upload") {
+            frame.upload = duration;
+        } else {
+            for (int pass = 0; pass < SortPassCount; ++pass) {
+                if (zone.name == string("sort ") + getSortPassName(static_cast<SortPass>(pass)))
+                    frame.sort[pass] = duration;
+            }
+        }
+    }
+
+    frame.sortStats = sortStats;
+    sortStats = SortStats();
+
+    if (movie_) {
+        sfe::PlaybackStatistics statistics = movie_->getPlaybackStatistics();
+        frame.queuedPackets = statistics.queuedVideoPackets;
+        frame.synchronizationGap = statistics.synchronizationGap;
+
+        // Frames decoded since the previous one beyond the one shown were
+        // never sorted. Rewinding a looping movie resets its count.
+        if (movie_ == movie && statistics.decodedFrames > decodedFrames + 1)
+            skippedFrames += statistics.decodedFrames - decodedFrames - 1;
+        decodedFrames = statistics.decodedFrames;
+    }
+    movie = movie_;
+
+    frame.recorderQueue = recorder.getQueueDepth();
+    frame.skippedFrames = skippedFrames;
+    frame.recorderDroppedFrames = recorder.getDroppedFrames();
+
+    unsigned long count = getAllocationCount();
+    frame.allocations = count - allocations;
+    allocations = count;
+    frame.residentMemory = getResidentMemory();
+
+    last = frame;
+}
+
+const FrameProfile& FrameProfiler::getLastFrame() const
+{
+    return last;
+}
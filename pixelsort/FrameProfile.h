@@ -0,0 +1,77 @@
+//
+//  FrameProfile.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_FrameProfile_h
+#define pixelsort_FrameProfile_h
+
+#include <SFML/System.hpp>
+
+#include "Recorder.h"
+#include "prettysort.h"
+#include "video/Movie.hpp"
+
+// Where the time and the work of one frame of the app went.
+struct FrameProfile
+{
+    FrameProfile();
+
+    // Summed over every zone of that name that ended during the frame, on
+    // the main thread, see video/Trace.hpp
+    sf::Time decode;               // "decode"
+    sf::Time convert;              // "sws_scale"
+    sf::Time sort[SortPassCount];  // "sort circles", "sort cols"...
+    sf::Time upload;               // "texture upload"
+    sf::Time total;                // from the end of the previous frame
+
+    SortStats sortStats;
+
+    size_t queuedPackets;          // encoded video packets waiting for the decoder
+    sf::Time synchronizationGap;   // of the movie, negative when decoding is late
+    size_t recorderQueue;          // frames waiting for the recording sink
+
+    // Since the profiler was enabled: movie frames decoded but never
+    // sorted, and frames the recorder had no room for
+    unsigned long skippedFrames;
+    unsigned recorderDroppedFrames;
+
+    unsigned long allocations;     // during the frame, see AllocationCounter.h
+    size_t residentMemory;         // bytes, at the end of the frame
+};
+
+// Gathers a FrameProfile per frame. While enabled, zones are summed up by
+// the tracer, which costs a lock and a few additions per zone.
+class FrameProfiler
+{
+public:
+    FrameProfiler();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Where prettySort() counts the segments of the current frame,
+    // nullptr while disabled
+    SortStats* getSortStats();
+
+    // Closes the current frame. A movie that changed since the previous
+    // frame starts its count of skipped frames over.
+    void endFrame(const sfe::Movie* movie, const Recorder& recorder);
+
+    const FrameProfile& getLastFrame() const;
+
+private:
+    bool enabled;
+    FrameProfile last;
+    SortStats sortStats;
+    sf::Clock frameClock;
+
+    const sfe::Movie* movie;
+    sf::Int64 decodedFrames;
+    unsigned long skippedFrames;
+    unsigned long allocations;
+};
+
+#endif
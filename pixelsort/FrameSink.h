@@ -0,0 +1,30 @@
+//
+//  FrameSink.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_FrameSink_h
+#define pixelsort_FrameSink_h
+
+#include <string>
+
+#include <SFML/System.hpp>
+
+// Destination of recorded frames (a GIF, a video file...). A sink is driven
+// by a single thread: begin() once, write() for every frame, then end().
+// Frames are tightly packed RGBA, size.x * size.y * 4 bytes.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    virtual bool begin(const sf::Vector2u& size) = 0;
+    virtual bool write(const sf::Uint8* pixels, sf::Time timestamp) = 0;
+    virtual void end() = 0;
+
+    virtual std::string getPath() const = 0;
+};
+
+#endif
@@ -0,0 +1,47 @@
+//
+//  FrameSource.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "FrameSource.h"
+
+#include "video/Trace.hpp"
+
+using namespace std;
+using namespace sf;
+
+FrameSource::FrameSource(size_t capacity)
+    : pool(capacity)
+{
+}
+
+bool FrameSource::acquire(FrameView& frame)
+{
+    sfeTraceZone("acquire frame");
+
+    if (!pool.acquire(getSize(), frame))
+        return false;
+
+    if (!fill(frame)) {
+        pool.release(frame);
+        return false;
+    }
+    return true;
+}
+
+void FrameSource::release(const FrameView& frame)
+{
+    pool.release(frame);
+}
+
+float FrameSource::getRotation() const
+{
+    return 0;
+}
+
+size_t FrameSource::getCapacity() const
+{
+    return pool.getCapacity();
+}
@@ -0,0 +1,54 @@
+//
+//  FrameSource.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_FrameSource_h
+#define pixelsort_FrameSource_h
+
+#include <SFML/System.hpp>
+
+#include "FramePool.h"
+
+// Where frames to sort come from (a movie, the webcam, still images...).
+//
+// acquire() lends out a frame from the source's pool: the view stays valid
+// and writable until it is handed back with release(), so the sorter works
+// on it in place and the same pixels go on to the display, the recorder and
+// the frame ring without another copy. Sources write their frames straight
+// into the pool buffer; the only copy left is the one from a decoder's own
+// buffer where there is one. At most getCapacity() frames can be borrowed at
+// once, acquire() fails until one is released.
+class FrameSource
+{
+public:
+    explicit FrameSource(size_t capacity = 3);
+    virtual ~FrameSource() {}
+
+    virtual bool open() = 0;
+
+    // Borrow the next frame. Returns false if the source has none right now
+    // (not ready, at its end, or every buffer is borrowed).
+    bool acquire(FrameView& frame);
+    void release(const FrameView& frame);
+
+    // Size of the frames to come, (0, 0) until the source is opened.
+    virtual sf::Vector2u getSize() const = 0;
+
+    // Rotation in degrees to apply when displaying the frames.
+    virtual float getRotation() const;
+
+    size_t getCapacity() const;
+
+protected:
+    // Write the next frame into frame.pixels, sized and laid out as getSize()
+    // said, and set its timestamp.
+    virtual bool fill(FrameView& frame) = 0;
+
+private:
+    FramePool pool;
+};
+
+#endif
@@ -0,0 +1,595 @@
+//
+//  GifWriter.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "GifWriter.h"
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+using namespace sf;
+
+// The last palette entry is kept for transparent pixels
+static const int TransparentIndex = 255;
+static const int ColorCount = 255;
+
+// Shared palette: 6 levels of red, 7 of green, 6 of blue, then 3 grays.
+static const int RedLevels = 6;
+static const int GreenLevels = 7;
+static const int BlueLevels = 6;
+static const int CubeSize = RedLevels * GreenLevels * BlueLevels;
+
+static Uint8 level(int index, int levels)
+{
+    return static_cast<Uint8>(index * 255 / (levels - 1));
+}
+
+static void sharedPaletteColor(int index, Uint8* rgb)
+{
+    if (index < CubeSize) {
+        rgb[0] = level(index / (GreenLevels * BlueLevels), RedLevels);
+        rgb[1] = level((index / BlueLevels) % GreenLevels, GreenLevels);
+        rgb[2] = level(index % BlueLevels, BlueLevels);
+    } else if (index < ColorCount) {
+        Uint8 gray = static_cast<Uint8>((index - CubeSize + 1) * 255 / 4);
+        rgb[0] = rgb[1] = rgb[2] = gray;
+    } else {
+        rgb[0] = rgb[1] = rgb[2] = 0;
+    }
+}
+
+// Colors are bucketed to 5 bits per channel for palette lookups
+static inline int colorBin(const Uint8* p)
+{
+    return ((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3);
+}
+
+static inline int binChannel(int bin, int channel)
+{
+    return (bin >> (10 - 5 * channel)) & 31;
+}
+
+static inline int expandChannel(int value)
+{
+    return (value << 3) | (value >> 2);
+}
+
+static vector<Uint8> buildSharedLookup()
+{
+    vector<Uint8> lookup(32 * 32 * 32);
+    Uint8 palette[ColorCount][3];
+    for (int i = 0; i < ColorCount; ++i)
+        sharedPaletteColor(i, palette[i]);
+
+    for (int bin = 0; bin < 32 * 32 * 32; ++bin) {
+        int r = expandChannel(binChannel(bin, 0));
+        int g = expandChannel(binChannel(bin, 1));
+        int b = expandChannel(binChannel(bin, 2));
+        int best = 0, bestDistance = 1 << 30;
+        for (int i = 0; i < ColorCount; ++i) {
+            int dr = r - palette[i][0], dg = g - palette[i][1], db = b - palette[i][2];
+            int distance = 2 * dr * dr + 4 * dg * dg + 3 * db * db;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        lookup[bin] = static_cast<Uint8>(best);
+    }
+    return lookup;
+}
+
+// Nearest shared palette entry for every color bin
+static const vector<Uint8>& sharedLookup()
+{
+    static const vector<Uint8> lookup = buildSharedLookup();
+    return lookup;
+}
+
+// Median cut over the color bins of a histogram: the box with the widest
+// channel range is split at its weighted median until there are enough
+// boxes, then every box becomes the average of its colors.
+static void medianCut(const vector<Uint32>& histogram, Uint8 palette[256][3], vector<Uint8>& lookup)
+{
+    struct Bin
+    {
+        int color;
+        Uint32 count;
+    };
+
+    struct Box
+    {
+        size_t begin;
+        size_t end;
+        int channel;
+        int range;
+    };
+
+    vector<Bin> bins;
+    for (int i = 0; i < static_cast<int>(histogram.size()); ++i) {
+        if (histogram[i]) {
+            Bin bin = {i, histogram[i]};
+            bins.push_back(bin);
+        }
+    }
+
+    auto makeBox = [&bins](size_t begin, size_t end) {
+        Box box = {begin, end, 0, 0};
+        for (int channel = 0; channel < 3; ++channel) {
+            int low = 31, high = 0;
+            for (size_t i = begin; i < end; ++i) {
+                int value = binChannel(bins[i].color, channel);
+                low = min(low, value);
+                high = max(high, value);
+            }
+            if (high - low > box.range) {
+                box.range = high - low;
+                box.channel = channel;
+            }
+        }
+        return box;
+    };
+
+    vector<Box> boxes;
+    if (!bins.empty())
+        boxes.push_back(makeBox(0, bins.size()));
+
+    while (boxes.size() < static_cast<size_t>(ColorCount)) {
+        int widest = -1;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            if (boxes[i].range > 0 && (widest < 0 || boxes[i].range > boxes[widest].range))
+                widest = static_cast<int>(i);
+        }
+        if (widest < 0)
+            break;
+
+        Box box = boxes[widest];
+        int channel = box.channel;
+        sort(bins.begin() + box.begin, bins.begin() + box.end, [channel](const Bin& a, const Bin& b) {
+            return binChannel(a.color, channel) < binChannel(b.color, channel);
+        });
+
+        Uint64 total = 0;
+        for (size_t i = box.begin; i < box.end; ++i)
+            total += bins[i].count;
+
+        size_t middle = box.begin + 1;
+        Uint64 accumulated = bins[box.begin].count;
+        while (middle < box.end - 1 && accumulated * 2 < total)
+            accumulated += bins[middle++].count;
+
+        boxes[widest] = makeBox(box.begin, middle);
+        boxes.push_back(makeBox(middle, box.end));
+    }
+
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        Uint64 sums[3] = {0, 0, 0};
+        Uint64 total = 0;
+        for (size_t j = boxes[i].begin; j < boxes[i].end; ++j) {
+            for (int channel = 0; channel < 3; ++channel)
+                sums[channel] += static_cast<Uint64>(expandChannel(binChannel(bins[j].color, channel))) * bins[j].count;
+            total += bins[j].count;
+            lookup[bins[j].color] = static_cast<Uint8>(i);
+        }
+        for (int channel = 0; channel < 3; ++channel)
+            palette[i][channel] = static_cast<Uint8>((sums[channel] + total / 2) / total);
+    }
+    for (size_t i = boxes.size(); i < 256; ++i)
+        palette[i][0] = palette[i][1] = palette[i][2] = 0;
+}
+
+static void putShort(vector<Uint8>& out, unsigned value)
+{
+    out.push_back(static_cast<Uint8>(value & 0xFF));
+    out.push_back(static_cast<Uint8>((value >> 8) & 0xFF));
+}
+
+// LZW compression of 8-bit indices, the way giflib does it: an open
+// addressing hash table maps (prefix, pixel) to codes, and the code table
+// is reset with a clear code whenever it fills up.
+static void compressLzw(const Uint8* pixels, size_t count, vector<Uint8>& out)
+{
+    static const int MinCodeSize = 8;
+    static const int ClearCode = 1 << MinCodeSize;
+    static const int EndCode = ClearCode + 1;
+    static const int MaxCode = 4095;
+    static const int HashSize = 5003;
+
+    vector<Int32> hashKeys(HashSize, -1);
+    vector<Uint16> hashCodes(HashSize);
+
+    Uint8 block[256];
+    int blockLength = 0;
+    Uint32 bitBuffer = 0;
+    int bitCount = 0;
+    int codeSize = MinCodeSize + 1;
+    int nextCode = EndCode + 1;
+
+    auto flushBlock = [&]() {
+        if (blockLength > 0) {
+            out.push_back(static_cast<Uint8>(blockLength));
+            out.insert(out.end(), block, block + blockLength);
+            blockLength = 0;
+        }
+    };
+
+    auto output = [&](int code) {
+        bitBuffer |= static_cast<Uint32>(code) << bitCount;
+        bitCount += codeSize;
+        while (bitCount >= 8) {
+            block[blockLength++] = static_cast<Uint8>(bitBuffer & 0xFF);
+            bitBuffer >>= 8;
+            bitCount -= 8;
+            if (blockLength == 255)
+                flushBlock();
+        }
+        if (nextCode >= (1 << codeSize) && codeSize < 12)
+            ++codeSize;
+    };
+
+    out.push_back(MinCodeSize);
+    output(ClearCode);
+
+    if (count > 0) {
+        int prefix = pixels[0];
+        for (size_t i = 1; i < count; ++i) {
+            int pixel = pixels[i];
+            Int32 key = (prefix << 8) | pixel;
+            int slot = static_cast<int>(key % HashSize);
+
+            while (hashKeys[slot] != -1 && hashKeys[slot] != key) {
+                if (++slot == HashSize)
+                    slot = 0;
+            }
+
+            if (hashKeys[slot] == key) {
+                prefix = hashCodes[slot];
+                continue;
+            }
+
+            output(prefix);
+            prefix = pixel;
+
+            if (nextCode >= MaxCode) {
+                output(ClearCode);
+                nextCode = EndCode + 1;
+                codeSize = MinCodeSize + 1;
+                fill(hashKeys.begin(), hashKeys.end(), -1);
+            } else {
+                hashKeys[slot] = key;
+                hashCodes[slot] = static_cast<Uint16>(nextCode++);
+            }
+        }
+        output(prefix);
+    }
+
+    output(EndCode);
+    if (bitCount > 0) {
+        block[blockLength++] = static_cast<Uint8>(bitBuffer & 0xFF);
+        if (blockLength == 255)
+            flushBlock();
+    }
+    flushBlock();
+    out.push_back(0x00);
+}
+
+GifWriter::GifWriter()
+    : width(0)
+    , height(0)
+{
+}
+
+GifWriter::~GifWriter()
+{
+    if (isOpen())
+        close();
+}
+
+bool GifWriter::isOpen() const
+{
+    return file.is_open();
+}
+
+bool GifWriter::open(const string& path, unsigned width_, unsigned height_)
+{
+    if (isOpen() || width_ == 0 || height_ == 0 || width_ > 0xFFFF || height_ > 0xFFFF)
+        return false;
+
+    file.open(path.c_str(), ios::binary | ios::trunc);
+    if (!file)
+        return false;
+
+    width = width_;
+    height = height_;
+
+    // Header and logical screen descriptor, the shared palette is the
+    // global color table
+    file.write("GIF89a", 6);
+    writeShort(width);
+    writeShort(height);
+    file.put(static_cast<char>(0xF7));
+    file.put(0);
+    file.put(0);
+
+    for (int i = 0; i < 256; ++i) {
+        Uint8 rgb[3];
+        sharedPaletteColor(i, rgb);
+        file.write(reinterpret_cast<const char*>(rgb), 3);
+    }
+
+    // Loop forever
+    const char netscape[] = {0x21, (char)0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00};
+    file.write(netscape, sizeof(netscape));
+
+    return file.good();
+}
+
+bool GifWriter::writeEncodedFrame(const vector<Uint8>& encodedFrame)
+{
+    if (!isOpen())
+        return false;
+
+    file.write(reinterpret_cast<const char*>(encodedFrame.data()), encodedFrame.size());
+    return file.good();
+}
+
+bool GifWriter::writeFrame(const Uint8* rgba, unsigned delayCentiseconds)
+{
+    return writeEncodedFrame(encodeFrame(rgba, nullptr, width, height, delayCentiseconds, SharedPalette));
+}
+
+bool GifWriter::close()
+{
+    if (!isOpen())
+        return false;
+
+    file.put(0x3B);
+    bool ok = file.good();
+    file.close();
+    return ok;
+}
+
+void GifWriter::writeShort(unsigned value)
+{
+    file.put(static_cast<char>(value & 0xFF));
+    file.put(static_cast<char>((value >> 8) & 0xFF));
+}
+
+vector<Uint8> GifWriter::encodeFrame(const Uint8* rgba, const Uint8* previous,
+                                     unsigned width, unsigned height,
+                                     unsigned delayCentiseconds, PaletteMode paletteMode)
+{
+    const size_t count = static_cast<size_t>(width) * height;
+    vector<Uint8> indices(count);
+    Uint8 localPalette[256][3];
+
+    if (paletteMode == SharedPalette) {
+        // Unchanged pixels are found after quantization, so that the
+        // transparent ones show exactly the color they would have had
+        const vector<Uint8>& lookup = sharedLookup();
+        for (size_t i = 0; i < count; ++i) {
+            Uint8 index = lookup[colorBin(rgba + i * 4)];
+            if (previous && lookup[colorBin(previous + i * 4)] == index)
+                index = TransparentIndex;
+            indices[i] = index;
+        }
+    } else {
+        // Only the pixels that changed take part in the palette
+        auto unchanged = [&](size_t i) {
+            return previous && memcmp(rgba + i * 4, previous + i * 4, 3) == 0;
+        };
+
+        vector<Uint32> histogram(32 * 32 * 32, 0);
+        for (size_t i = 0; i < count; ++i) {
+            if (!unchanged(i))
+                histogram[colorBin(rgba + i * 4)]++;
+        }
+
+        vector<Uint8> lookup(32 * 32 * 32, 0);
+        medianCut(histogram, localPalette, lookup);
+
+        for (size_t i = 0; i < count; ++i)
+            indices[i] = unchanged(i) ? TransparentIndex : lookup[colorBin(rgba + i * 4)];
+    }
+
+    // Crop to the pixels that changed
+    unsigned left = 0, top = 0, right = width, bottom = height;
+    if (previous) {
+        left = width;
+        top = height;
+        right = bottom = 0;
+        for (unsigned y = 0; y < height; ++y) {
+            const Uint8* row = &indices[static_cast<size_t>(y) * width];
+            for (unsigned x = 0; x < width; ++x) {
+                if (row[x] != TransparentIndex) {
+                    left = min(left, x);
+                    right = max(right, x + 1);
+                    top = min(top, y);
+                    bottom = max(bottom, y + 1);
+                }
+            }
+        }
+
+        // Nothing changed, the frame is still needed for its delay
+        if (right == 0) {
+            left = top = 0;
+            right = bottom = 1;
+        }
+    }
+
+    vector<Uint8> out;
+    out.reserve(count / 2 + 1024);
+
+    // Graphic control extension: delay, and transparency on top of the
+    // previous frame, which is left in place
+    out.push_back(0x21);
+    out.push_back(0xF9);
+    out.push_back(0x04);
+    out.push_back(previous ? 0x05 : 0x04);
+    putShort(out, min(delayCentiseconds, 0xFFFFu));
+    out.push_back(previous ? TransparentIndex : 0x00);
+    out.push_back(0x00);
+
+    // Image descriptor, with a local color table for per frame palettes
+    out.push_back(0x2C);
+    putShort(out, left);
+    putShort(out, top);
+    putShort(out, right - left);
+    putShort(out, bottom - top);
+    if (paletteMode == PerFramePalette) {
+        out.push_back(0x87);
+        out.insert(out.end(), &localPalette[0][0], &localPalette[0][0] + sizeof(localPalette));
+    } else {
+        out.push_back(0x00);
+    }
+
+    if (left == 0 && top == 0 && right == width && bottom == height) {
+        compressLzw(indices.data(), count, out);
+    } else {
+        vector<Uint8> cropped;
+        cropped.reserve(static_cast<size_t>(right - left) * (bottom - top));
+        for (unsigned y = top; y < bottom; ++y) {
+            const Uint8* row = &indices[static_cast<size_t>(y) * width];
+            cropped.insert(cropped.end(), row + left, row + right);
+        }
+        compressLzw(cropped.data(), cropped.size(), out);
+    }
+
+    return out;
+}
+
+GifSink::GifSink(const string& path_, GifWriter::PaletteMode paletteMode_, bool frameDifferences_, unsigned threadCount_)
+    : path(path_)
+    , paletteMode(paletteMode_)
+    , frameDifferences(frameDifferences_)
+    , threadCount(threadCount_ ? threadCount_ : max(1u, thread::hardware_concurrency()))
+    , lastTimestamp(Time::Zero)
+    , frameCount(0)
+    , failed(false)
+    , stopping(false)
+{
+}
+
+GifSink::~GifSink()
+{
+    stopWorkers();
+}
+
+bool GifSink::begin(const Vector2u& size_)
+{
+    size = size_;
+    frameCount = 0;
+    failed = false;
+    lastTimestamp = Time::Zero;
+    previousFrame.reset();
+
+    if (!writer.open(path, size.x, size.y))
+        return false;
+
+    for (unsigned i = 0; i < threadCount; ++i)
+        workers.push_back(thread(&GifSink::workLoop, this));
+    return true;
+}
+
+// GIF delays are set per frame before the next one is known, so each frame
+// lasts as long as the interval that preceded it.
+bool GifSink::write(const Uint8* pixels, Time timestamp)
+{
+    if (!writer.isOpen())
+        return false;
+
+    unsigned delay = 3;
+    if (frameCount > 0) {
+        Int64 elapsed = (timestamp - lastTimestamp).asMicroseconds();
+        delay = static_cast<unsigned>(max<Int64>(2, (elapsed + 5000) / 10000));
+    }
+    lastTimestamp = timestamp;
+    frameCount++;
+
+    shared_ptr<vector<Uint8>> frame = make_shared<vector<Uint8>>(pixels, pixels + static_cast<size_t>(size.x) * size.y * 4);
+    shared_ptr<vector<Uint8>> previous = frameDifferences ? previousFrame : nullptr;
+    previousFrame = frame;
+
+    unsigned width = size.x, height = size.y;
+    GifWriter::PaletteMode mode = paletteMode;
+    auto task = make_shared<packaged_task<vector<Uint8>()>>([=]() {
+        return GifWriter::encodeFrame(frame->data(), previous ? previous->data() : nullptr, width, height, delay, mode);
+    });
+    pending.push_back(task->get_future());
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+        tasks.push_back([task]() { (*task)(); });
+    }
+    taskQueued.notify_one();
+
+    return writeCompletedFrames(2 * threadCount);
+}
+
+// Write the encoded frames at the front of the queue that are done, and
+// wait for the oldest ones while more than maxPending are in flight.
+bool GifSink::writeCompletedFrames(size_t maxPending)
+{
+    while (!pending.empty()) {
+        future<vector<Uint8>>& next = pending.front();
+        if (pending.size() <= maxPending && next.wait_for(chrono::seconds(0)) != future_status::ready)
+            break;
+
+        vector<Uint8> encodedFrame = next.get();
+        pending.pop_front();
+        if (!failed && !writer.writeEncodedFrame(encodedFrame))
+            failed = true;
+    }
+    return !failed;
+}
+
+void GifSink::end()
+{
+    writeCompletedFrames(0);
+    stopWorkers();
+    previousFrame.reset();
+
+    if (!writer.close() || failed)
+        cerr << "Error while writing " << path << endl;
+}
+
+string GifSink::getPath() const
+{
+    return path;
+}
+
+void GifSink::stopWorkers()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskQueued.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+    stopping = false;
+}
+
+void GifSink::workLoop()
+{
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        taskQueued.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty())
+            return;
+
+        function<void()> task = move(tasks.front());
+        tasks.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
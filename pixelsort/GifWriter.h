@@ -0,0 +1,110 @@
+//
+//  GifWriter.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_GifWriter_h
+#define pixelsort_GifWriter_h
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <SFML/System.hpp>
+
+#include "FrameSink.h"
+
+// Writes an animated GIF one frame at a time, so that memory use doesn't
+// depend on the length of the animation.
+//
+// Encoding a frame (quantization and LZW compression) doesn't touch the
+// file: encodeFrame() can run on several frames in parallel, and the
+// results are appended in order with writeEncodedFrame().
+class GifWriter
+{
+public:
+    enum PaletteMode
+    {
+        SharedPalette,      // fixed 6x7x6 color cube plus grays, fastest
+        PerFramePalette     // median cut palette computed for every frame
+    };
+
+    GifWriter();
+    ~GifWriter();
+
+    bool open(const std::string& path, unsigned width, unsigned height);
+    bool writeEncodedFrame(const std::vector<sf::Uint8>& encodedFrame);
+    bool writeFrame(const sf::Uint8* rgba, unsigned delayCentiseconds);
+    bool close();
+
+    bool isOpen() const;
+
+    // Quantize and compress an RGBA frame. When previous is given, pixels
+    // that didn't change since the previous frame are made transparent and
+    // the frame is cropped to the area that did change.
+    static std::vector<sf::Uint8> encodeFrame(const sf::Uint8* rgba, const sf::Uint8* previous,
+                                              unsigned width, unsigned height,
+                                              unsigned delayCentiseconds, PaletteMode paletteMode);
+
+private:
+    void writeShort(unsigned value);
+
+    std::ofstream file;
+    unsigned width;
+    unsigned height;
+};
+
+// FrameSink writing an animated GIF with GifWriter. Frames are encoded by a
+// pool of worker threads and written in order as they complete; at most two
+// frames per worker are in flight, which bounds memory use.
+class GifSink : public FrameSink
+{
+public:
+    explicit GifSink(const std::string& path,
+                     GifWriter::PaletteMode paletteMode = GifWriter::SharedPalette,
+                     bool frameDifferences = true,
+                     unsigned threadCount = 0);
+    ~GifSink();
+
+    bool begin(const sf::Vector2u& size);
+    bool write(const sf::Uint8* pixels, sf::Time timestamp);
+    void end();
+
+    std::string getPath() const;
+
+private:
+    bool writeCompletedFrames(size_t maxPending);
+    void stopWorkers();
+    void workLoop();
+
+    std::string path;
+    GifWriter::PaletteMode paletteMode;
+    bool frameDifferences;
+    unsigned threadCount;
+
+    GifWriter writer;
+    sf::Vector2u size;
+    sf::Time lastTimestamp;
+    unsigned frameCount;
+    bool failed;
+
+    std::shared_ptr<std::vector<sf::Uint8>> previousFrame;
+    std::deque<std::future<std::vector<sf::Uint8>>> pending;
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable taskQueued;
+};
+
+#endif
@@ -0,0 +1,84 @@
+//
+//  ImageSequenceSource.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "ImageSequenceSource.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+using namespace sf;
+
+static const size_t NoImage = static_cast<size_t>(-1);
+
+ImageSequenceSource::ImageSequenceSource(const vector<string>& paths_, float frameRate_)
+    : paths(paths_)
+    , frameRate(frameRate_ > 0 ? frameRate_ : 30)
+    , loadedIndex(NoImage)
+    , nextIndex(0)
+    , frameCount(0)
+{
+}
+
+bool ImageSequenceSource::open()
+{
+    size = Vector2u();
+    loadedIndex = NoImage;
+    nextIndex = 0;
+    frameCount = 0;
+
+    // The first image that loads sets the size of the sequence
+    for (size_t i = 0; i < paths.size() && size.x == 0; ++i) {
+        if (load(i))
+            nextIndex = i;
+    }
+    return size.x > 0 && size.y > 0;
+}
+
+Vector2u ImageSequenceSource::getSize() const
+{
+    return size;
+}
+
+bool ImageSequenceSource::load(size_t index)
+{
+    if (index == loadedIndex)
+        return true;
+
+    if (!image.loadFromFile(paths[index])) {
+        loadedIndex = NoImage;
+        return false;
+    }
+
+    if (size.x == 0) {
+        size = image.getSize();
+    } else if (image.getSize() != size) {
+        cerr << "Skipping " << paths[index] << ", its size differs from the first image" << endl;
+        loadedIndex = NoImage;
+        return false;
+    }
+
+    loadedIndex = index;
+    return true;
+}
+
+bool ImageSequenceSource::fill(FrameView& frame)
+{
+    // Give up after a whole round of images that don't load
+    for (size_t attempt = 0; attempt < paths.size(); ++attempt) {
+        size_t index = nextIndex;
+        nextIndex = (nextIndex + 1) % paths.size();
+
+        if (load(index)) {
+            memcpy(frame.pixels, image.getPixelsPtr(), size.x * size.y * 4);
+            frame.timestamp = seconds(frameCount / frameRate);
+            frameCount++;
+            return true;
+        }
+    }
+    return false;
+}
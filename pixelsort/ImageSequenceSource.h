@@ -0,0 +1,50 @@
+//
+//  ImageSequenceSource.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_ImageSequenceSource_h
+#define pixelsort_ImageSequenceSource_h
+
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSource.h"
+
+// Still images played one after the other at a fixed frame rate, looping
+// at the end; a single image is a sequence that never changes. Every
+// acquire() moves to the next image, so frames come out in the same order
+// with the same timestamps on every run.
+//
+// An image is only decoded again when the sequence moves to another one,
+// a still image costs a copy per frame. Images of another size than the
+// first one are skipped.
+class ImageSequenceSource : public FrameSource
+{
+public:
+    explicit ImageSequenceSource(const std::vector<std::string>& paths, float frameRate = 30);
+
+    bool open();
+    sf::Vector2u getSize() const;
+
+protected:
+    bool fill(FrameView& frame);
+
+private:
+    bool load(size_t index);
+
+    std::vector<std::string> paths;
+    float frameRate;
+    sf::Vector2u size;
+
+    sf::Image image;
+    size_t loadedIndex;
+    size_t nextIndex;
+    long frameCount;
+};
+
+#endif
@@ -0,0 +1,201 @@
+//
+//  MetricsWriter.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "MetricsWriter.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace sf;
+
+// A reader that stalls costs at most this much memory before records are
+// dropped
+static const size_t MaxPending = 64 * 1024;
+
+static const Time RetryInterval = seconds(1);
+
+static double milliseconds(Time time)
+{
+    return time.asMicroseconds() / 1000.0;
+}
+
+MetricsWriter::MetricsWriter()
+    : opened(false)
+    , fifo(false)
+    , file(-1)
+    , frameIndex(0)
+    , droppedRecords(0)
+{
+}
+
+MetricsWriter::~MetricsWriter()
+{
+    close();
+}
+
+bool MetricsWriter::open(const string& path_)
+{
+    close();
+    path = path_;
+
+    struct stat status;
+    fifo = stat(path.c_str(), &status) == 0 && S_ISFIFO(status.st_mode);
+
+    if (fifo) {
+        // Writing to a pipe whose reader left raises SIGPIPE, which would
+        // quit the app; the write fails with EPIPE instead
+        signal(SIGPIPE, SIG_IGN);
+    } else if (!openFile()) {
+        cerr << "Could not write metrics to " << path << endl;
+        return false;
+    }
+
+    opened = true;
+    frameIndex = 0;
+    droppedRecords = 0;
+    return true;
+}
+
+bool MetricsWriter::isOpen() const
+{
+    return opened;
+}
+
+void MetricsWriter::close()
+{
+    if (opened) {
+        // Whatever a stalled reader didn't take is lost
+        flush();
+        closeFile();
+        opened = false;
+    }
+}
+
+bool MetricsWriter::openFile()
+{
+    if (fifo) {
+        // Fails with ENXIO while nobody reads the pipe
+        file = ::open(path.c_str(), O_WRONLY | O_NONBLOCK);
+    } else {
+        file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    }
+    retryClock.restart();
+    return file >= 0;
+}
+
+void MetricsWriter::closeFile()
+{
+    if (file >= 0) {
+        ::close(file);
+        file = -1;
+    }
+    pending.clear();
+}
+
+bool MetricsWriter::flush()
+{
+    while (file >= 0 && !pending.empty()) {
+        ssize_t written = ::write(file, pending.data(), pending.size());
+        if (written > 0) {
+            pending.erase(0, written);
+        } else if (written < 0 && errno == EINTR) {
+            continue;
+        } else if (written < 0 && errno == EAGAIN) {
+            return true;
+        } else {
+            if (!fifo)
+                cerr << "Could not write metrics to " << path << ", stopped writing them" << endl;
+            closeFile();
+            return false;
+        }
+    }
+    return true;
+}
+
+void MetricsWriter::write(const FrameProfile& frame)
+{
+    if (!opened)
+        return;
+
+    long index = frameIndex++;
+    if (file < 0) {
+        if (!fifo) {
+            opened = false;
+            return;
+        }
+        if (retryClock.getElapsedTime() < RetryInterval || !openFile()) {
+            droppedRecords++;
+            return;
+        }
+    }
+
+    if (pending.size() > MaxPending) {
+        droppedRecords++;
+        flush();
+        return;
+    }
+
+    double now = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count() / 1e6;
+
+    ostringstream record;
+    record << fixed << setprecision(3);
+    record << "{\"frame\": " << index
+           << ", \"time\": " << now
+           << ", \"frameMs\": " << milliseconds(frame.total)
+           << ", \"decodeMs\": " << milliseconds(frame.decode)
+           << ", \"convertMs\": " << milliseconds(frame.convert)
+           << ", \"uploadMs\": " << milliseconds(frame.upload)
+           << ", \"sortKey\": \"" << getSortKeyName(frame.sortStats.key) << "\"";
+
+    long segments = 0;
+    long sortedPixels = 0;
+    record << ", \"passes\": {";
+    for (int pass = 0; pass < SortPassCount; ++pass) {
+        const SegmentStats& stats = frame.sortStats.passes[pass];
+        record << (pass > 0 ? ", " : "") << "\"" << getSortPassName(static_cast<SortPass>(pass)) << "\": {"
+               << "\"sortMs\": " << milliseconds(frame.sort[pass])
+               << ", \"segments\": " << stats.segments
+               << ", \"sortedPixels\": " << stats.sortedPixels
+               << ", \"skippedFraction\": " << stats.getSkippedFraction()
+               << ", \"lengthHistogram\": [";
+        for (int bucket = 0; bucket < SegmentStats::HistogramBuckets; ++bucket)
+            record << (bucket > 0 ? ", " : "") << stats.lengthHistogram[bucket];
+        record << "]}";
+        segments += stats.segments;
+        sortedPixels += stats.sortedPixels;
+    }
+    record << "}";
+
+    record << ", \"segments\": " << segments
+           << ", \"meanSegmentLength\": " << (segments > 0 ? static_cast<double>(sortedPixels) / segments : 0.0)
+           << ", \"queuedPackets\": " << frame.queuedPackets
+           << ", \"recorderQueue\": " << frame.recorderQueue
+           << ", \"decoderLagMs\": " << milliseconds(Time::Zero - frame.synchronizationGap)
+           << ", \"skippedFrames\": " << frame.skippedFrames
+           << ", \"recorderDroppedFrames\": " << frame.recorderDroppedFrames
+           << ", \"allocations\": " << frame.allocations
+           << ", \"residentBytes\": " << frame.residentMemory
+           << ", \"droppedRecords\": " << droppedRecords
+           << "}\n";
+
+    // Lines only ever reach the reader whole, a partial write keeps the
+    // rest for the next frame
+    pending += record.str();
+    droppedRecords = 0;
+
+    if (!flush() && fifo)
+        droppedRecords++;
+}
@@ -0,0 +1,58 @@
+//
+//  MetricsWriter.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_MetricsWriter_h
+#define pixelsort_MetricsWriter_h
+
+#include <string>
+
+#include <SFML/System.hpp>
+
+#include "FrameProfile.h"
+
+// Appends the FrameProfile of every frame to a file as one JSON object per
+// line, for monitoring to tail:
+//
+//   {"frame": 1234, "time": 1424563200.125, "frameMs": 33.41, "decodeMs": 4.10, ...}
+//
+// Every sort pass has its own entry in "passes", with its time, segments,
+// fraction of pixels skipped and histogram of segment lengths, see
+// SegmentStats in prettysort.h.
+//
+// The path can also be a named pipe (mkfifo). The app never waits for its
+// reader: until one shows up, and whenever the pipe is full, records are
+// dropped and counted in the "droppedRecords" of the next one written. A
+// reader that goes away is waited for again.
+class MetricsWriter
+{
+public:
+    MetricsWriter();
+    ~MetricsWriter();
+
+    bool open(const std::string& path);
+    bool isOpen() const;
+    void close();
+
+    void write(const FrameProfile& frame);
+
+private:
+    bool openFile();
+    void closeFile();
+    bool flush();
+
+    std::string path;
+    bool opened;
+    bool fifo;
+    int file;
+    sf::Clock retryClock;
+
+    std::string pending;
+    long frameIndex;
+    unsigned long droppedRecords;
+};
+
+#endif
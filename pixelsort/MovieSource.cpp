@@ -0,0 +1,48 @@
+//
+//  MovieSource.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "MovieSource.h"
+
+using namespace std;
+using namespace sf;
+
+MovieSource::MovieSource(shared_ptr<sfe::Movie> movie_, Mode mode_)
+    : movie(movie_)
+    , mode(mode_)
+{
+}
+
+bool MovieSource::open()
+{
+    return movie && getSize().x > 0 && getSize().y > 0;
+}
+
+Vector2u MovieSource::getSize() const
+{
+    return movie ? Vector2u(movie->getSize()) : Vector2u();
+}
+
+float MovieSource::getRotation() const
+{
+    return movie ? movie->getVideoRotation() : 0;
+}
+
+shared_ptr<sfe::Movie> MovieSource::getMovie() const
+{
+    return movie;
+}
+
+bool MovieSource::fill(FrameView& frame)
+{
+    if (mode == FrameStep)
+        return movie->nextFrame(frame.pixels, &frame.timestamp);
+
+    if (movie->getStatus() == sfe::Status::Stopped)
+        movie->play();
+    movie->update();
+    return movie->copyCurrentFrame(frame.pixels, &frame.timestamp);
+}
@@ -0,0 +1,46 @@
+//
+//  MovieSource.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_MovieSource_h
+#define pixelsort_MovieSource_h
+
+#include <memory>
+
+#include "FrameSource.h"
+#include "video/Movie.hpp"
+
+// Frames of an opened sfe::Movie, copied from the decoder's RGBA buffer.
+class MovieSource : public FrameSource
+{
+public:
+    enum Mode
+    {
+        // Play the movie and hand out whatever frame is current, the same
+        // one again if the decoder didn't get to the next one yet
+        Playback,
+
+        // Decode exactly one new frame per acquire(), for offline work
+        FrameStep
+    };
+
+    MovieSource(std::shared_ptr<sfe::Movie> movie, Mode mode = Playback);
+
+    bool open();
+    sf::Vector2u getSize() const;
+    float getRotation() const;
+
+    std::shared_ptr<sfe::Movie> getMovie() const;
+
+protected:
+    bool fill(FrameView& frame);
+
+private:
+    std::shared_ptr<sfe::Movie> movie;
+    Mode mode;
+};
+
+#endif
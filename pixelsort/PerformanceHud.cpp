@@ -0,0 +1,124 @@
+//
+//  PerformanceHud.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "PerformanceHud.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ResourcePath.hpp"
+
+using namespace std;
+using namespace sf;
+
+static const unsigned CharacterSize = 14;
+static const float LineHeight = 18;
+static const float Margin = 8;
+
+static string formatTime(const string& label, Time time)
+{
+    ostringstream stream;
+    stream << label << "  " << fixed << setprecision(2) << time.asMicroseconds() / 1000.0 << " ms";
+    return stream.str();
+}
+
+PerformanceHud::PerformanceHud(Time budget_)
+    : budget(budget_)
+    , fontLoaded(false)
+{
+}
+
+bool PerformanceHud::loadFont()
+{
+    if (fontLoaded)
+        return true;
+
+    fontLoaded = font.loadFromFile(resourcePath() + "sansation.ttf");
+    if (!fontLoaded)
+        cerr << "Could not load sansation.ttf, no performance overlay" << endl;
+    return fontLoaded;
+}
+
+void PerformanceHud::addLine(const string& text, Time time)
+{
+    Line line = {text, time};
+    lines.push_back(line);
+}
+
+void PerformanceHud::draw(RenderTarget& target, const FrameProfile& frame)
+{
+    if (!fontLoaded)
+        return;
+
+    lines.clear();
+    addLine(formatTime("frame", frame.total) + ", sorting by " + getSortKeyName(frame.sortStats.key));
+    addLine(formatTime("decode", frame.decode), frame.decode);
+    addLine(formatTime("convert", frame.convert), frame.convert);
+
+    long segments = 0;
+    long sortedPixels = 0;
+    for (int pass = 0; pass < SortPassCount; ++pass) {
+        const SegmentStats& stats = frame.sortStats.passes[pass];
+        if (frame.sort[pass] == Time::Zero && stats.segments == 0)
+            continue;
+
+        ostringstream text;
+        text << formatTime(string("sort ") + getSortPassName(static_cast<SortPass>(pass)), frame.sort[pass])
+             << "  " << stats.segments << " segments, " << fixed << setprecision(0) << stats.getSkippedFraction() * 100
+             << "% skipped";
+        addLine(text.str(), frame.sort[pass]);
+        segments += stats.segments;
+        sortedPixels += stats.sortedPixels;
+    }
+
+    addLine(formatTime("upload", frame.upload), frame.upload);
+
+    ostringstream segmentText;
+    segmentText << segments << " segments, mean length " << fixed << setprecision(1)
+                << (segments > 0 ? static_cast<double>(sortedPixels) / segments : 0.0) << " px";
+    addLine(segmentText.str());
+
+    ostringstream queueText;
+    queueText << "queued: " << frame.queuedPackets << " packets, " << frame.recorderQueue << " frames to record";
+    addLine(queueText.str());
+
+    // Late decoding shows as a positive lag
+    addLine(formatTime("decoder lag", Time::Zero - frame.synchronizationGap));
+
+    ostringstream droppedText;
+    droppedText << "dropped: " << frame.skippedFrames << " decoded, " << frame.recorderDroppedFrames << " recorded";
+    addLine(droppedText.str());
+
+    ostringstream allocationText;
+    allocationText << frame.allocations << " allocations, " << frame.residentMemory / (1024 * 1024) << " MB resident";
+    addLine(allocationText.str());
+
+    // The stage to blame, when there is something to blame
+    size_t slowest = lines.size();
+    if (frame.total > budget) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            if (lines[i].time > Time::Zero && (slowest == lines.size() || lines[i].time > lines[slowest].time))
+                slowest = i;
+        }
+    }
+
+    RectangleShape background(Vector2f(400, lines.size() * LineHeight + 2 * Margin));
+    background.setFillColor(Color(0, 0, 0, 160));
+    target.draw(background);
+
+    Text text;
+    text.setFont(font);
+    text.setCharacterSize(CharacterSize);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        bool overBudget = i == slowest || (i == 0 && frame.total > budget);
+        text.setString(lines[i].text);
+        text.setColor(overBudget ? Color(255, 80, 80) : Color::White);
+        text.setPosition(Margin, Margin + i * LineHeight);
+        target.draw(text);
+    }
+}
@@ -0,0 +1,51 @@
+//
+//  PerformanceHud.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_PerformanceHud_h
+#define pixelsort_PerformanceHud_h
+
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameProfile.h"
+
+// Overlay showing the FrameProfile of the last frame in the corner of the
+// window: the stage and sort pass times, the segments sorted, the queues,
+// the dropped frames and the allocations. The most expensive stage is
+// drawn in red when the frame went over its budget, to tell at a glance
+// what to turn down.
+//
+// The overlay allocates its own strings, which count in the allocations of
+// the next frame.
+class PerformanceHud
+{
+public:
+    explicit PerformanceHud(sf::Time budget = sf::seconds(1.0f / 30));
+
+    // Loads sansation.ttf from the resources, once
+    bool loadFont();
+
+    void draw(sf::RenderTarget& target, const FrameProfile& frame);
+
+private:
+    struct Line
+    {
+        std::string text;
+        sf::Time time;
+    };
+
+    void addLine(const std::string& text, sf::Time time = sf::Time::Zero);
+
+    sf::Time budget;
+    sf::Font font;
+    bool fontLoaded;
+    std::vector<Line> lines;
+};
+
+#endif
@@ -0,0 +1,233 @@
+//
+//  Playlist.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "Playlist.h"
+#include "video/Trace.hpp"
+
+#include <SFML/Window.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+static const size_t NotLoading = static_cast<size_t>(-1);
+
+Playlist::Playlist(const vector<Media>& medias_, size_t preloadBudget_, sfe::InputMode inputMode_)
+    : medias(medias_)
+    , index(0)
+    , preloadBudget(max<size_t>(1, preloadBudget_))
+    , inputMode(inputMode_)
+    , loading(NotLoading)
+    , stopping(false)
+{
+    loader = thread(&Playlist::loadLoop, this);
+
+    lock_guard<std::mutex> lock(mutex);
+    schedule();
+}
+
+Playlist::~Playlist()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.clear();
+    }
+    wakeup.notify_all();
+    loader.join();
+}
+
+size_t Playlist::size() const
+{
+    return medias.size();
+}
+
+size_t Playlist::getIndex() const
+{
+    return index;
+}
+
+const Media& Playlist::getMedia() const
+{
+    return medias[index];
+}
+
+const Media& Playlist::getMedia(size_t i) const
+{
+    return medias[i];
+}
+
+void Playlist::select(size_t newIndex)
+{
+    if (medias.empty())
+        return;
+
+    vector<shared_ptr<sfe::Movie>> evicted;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        index = newIndex % medias.size();
+
+        // Movies that went out of budget are destroyed outside of the lock
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (!isWanted(it->first)) {
+                evicted.push_back(it->second.movie);
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = stopped.begin(); it != stopped.end();) {
+            if (!isWanted(it->first)) {
+                evicted.push_back(it->second);
+                it = stopped.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        schedule();
+    }
+    wakeup.notify_all();
+}
+
+void Playlist::next()
+{
+    select(index + 1);
+}
+
+void Playlist::previous()
+{
+    select(index + medias.size() - 1);
+}
+
+shared_ptr<sfe::Movie> Playlist::getMovie()
+{
+    lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(index);
+    if (it == entries.end())
+        return nullptr;
+    return it->second.movie;
+}
+
+bool Playlist::didFail() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(index);
+    return it != entries.end() && it->second.failed;
+}
+
+void Playlist::recycle(size_t i)
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(i);
+        if (it == entries.end() || !it->second.movie)
+            return;
+
+        // Out of the entries until the loader decoded its first frame again
+        stopped[i] = it->second.movie;
+        entries.erase(it);
+        schedule();
+    }
+    wakeup.notify_all();
+}
+
+size_t Playlist::distance(size_t a, size_t b) const
+{
+    size_t forward = (b + medias.size() - a) % medias.size();
+    return min(forward, medias.size() - forward);
+}
+
+// An entry is wanted if it is one of the preloadBudget movies closest to the
+// current entry, the next entries winning over the previous ones.
+bool Playlist::isWanted(size_t i) const
+{
+    if (medias[i].type != Media::MOVIE)
+        return false;
+
+    size_t closer = 0;
+    size_t d = distance(index, i);
+    for (size_t other = 0; other < medias.size(); ++other) {
+        if (other == i || medias[other].type != Media::MOVIE)
+            continue;
+        size_t otherDistance = distance(index, other);
+        if (otherDistance < d || (otherDistance == d && other == (index + d) % medias.size()))
+            ++closer;
+    }
+    return closer < preloadBudget;
+}
+
+// Must be called with the mutex held
+void Playlist::schedule()
+{
+    pending.clear();
+
+    // Current entry first, then alternate between the next and previous ones
+    for (size_t d = 0; d <= medias.size() / 2; ++d) {
+        size_t candidates[2] = {(index + d) % medias.size(), (index + medias.size() - d) % medias.size()};
+        for (size_t candidate : candidates) {
+            if (entries.count(candidate) || candidate == loading || !isWanted(candidate))
+                continue;
+            if (find(pending.begin(), pending.end(), candidate) == pending.end())
+                pending.push_back(candidate);
+        }
+    }
+}
+
+void Playlist::loadLoop()
+{
+    sfe::Trace::setThreadName("playlist loader");
+
+    // Opening a movie creates its texture and preloading fills it, this
+    // context shares them with the window's
+    sf::Context context;
+
+    unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        if (pending.empty()) {
+            wakeup.wait(lock);
+            continue;
+        }
+
+        loading = pending.front();
+        pending.pop_front();
+        string filename = medias[loading].filename;
+        Entry entry = {nullptr, false};
+        auto recycled = stopped.find(loading);
+        if (recycled != stopped.end()) {
+            entry.movie = recycled->second;
+            stopped.erase(recycled);
+        }
+        lock.unlock();
+
+        bool ok;
+        if (entry.movie) {
+            ok = entry.movie->preload();
+        } else {
+            cout << "Preloading movie " << filename << endl;
+            entry.movie = make_shared<sfe::Movie>();
+            ok = entry.movie->openFromFile(filename, inputMode) && entry.movie->preload();
+        }
+
+        if (!ok) {
+            cerr << "Could not preload " << filename << endl;
+            entry.movie = nullptr;
+            entry.failed = true;
+        }
+
+        lock.lock();
+        if (!stopping && isWanted(loading)) {
+            entries[loading] = entry;
+        }
+        loading = NotLoading;
+
+        if (!entries.count(index) && isWanted(index))
+            schedule();
+    }
+}
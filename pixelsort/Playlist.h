@@ -0,0 +1,99 @@
+//
+//  Playlist.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_Playlist_h
+#define pixelsort_Playlist_h
+
+#include <vector>
+#include <string>
+#include <map>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "video/Movie.hpp"
+
+using std::string;
+using std::vector;
+
+struct Media
+{
+    enum MediaType
+    {
+        IMAGE,
+        MOVIE,
+        WEBCAM,
+        SYNTHETIC
+    };
+
+    MediaType type;
+    string filename;
+};
+
+// Keeps the movies around the current playlist entry opened, probed and
+// with their first frame decoded, so that switching media doesn't stall
+// the render thread. Movies are loaded by a background thread, with its own
+// GL context for the textures; at most preloadBudget movies (the current one
+// included) are kept alive.
+class Playlist
+{
+public:
+    Playlist(const vector<Media>& medias, size_t preloadBudget = 3, sfe::InputMode inputMode = sfe::DefaultInput);
+    ~Playlist();
+
+    size_t size() const;
+    size_t getIndex() const;
+    const Media& getMedia() const;
+    const Media& getMedia(size_t index) const;
+
+    // Change the current entry and schedule the preloading of its neighbours.
+    void select(size_t index);
+    void next();
+    void previous();
+
+    // Returns the opened movie for the current entry, or nullptr if it isn't
+    // a movie, failed to open, or is still being loaded in the background.
+    std::shared_ptr<sfe::Movie> getMovie();
+
+    // Tell whether the current entry failed to load.
+    bool didFail() const;
+
+    // Hand back the movie of an entry once it was stopped, stopping forgets
+    // the decoded first frame and the background thread decodes it again.
+    void recycle(size_t index);
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<sfe::Movie> movie;
+        bool failed;
+    };
+
+    size_t distance(size_t a, size_t b) const;
+    bool isWanted(size_t index) const;
+    void schedule();
+    void loadLoop();
+
+    vector<Media> medias;
+    size_t index;
+    size_t preloadBudget;
+    sfe::InputMode inputMode;
+
+    std::map<size_t, Entry> entries;
+    std::map<size_t, std::shared_ptr<sfe::Movie>> stopped;
+    std::deque<size_t> pending;
+    size_t loading;
+    bool stopping;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    std::thread loader;
+};
+
+#endif
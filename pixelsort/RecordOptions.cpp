@@ -0,0 +1,61 @@
+//
+//  RecordOptions.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "RecordOptions.h"
+#include "VideoFileSink.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+RecordOptions::RecordOptions()
+    : path("/tmp/test.gif")
+    , speed(Recorder::Realtime)
+    , lossless(false)
+    , gifPalette(GifWriter::SharedPalette)
+    , gifFrameDifferences(true)
+{
+}
+
+bool parseRecordOption(int argc, char const** argv, int& i, RecordOptions& options)
+{
+    string argument = argv[i];
+    if (argument == "--record" && i + 1 < argc) {
+        options.path = argv[++i];
+    } else if (argument == "--offline") {
+        options.speed = Recorder::Offline;
+    } else if (argument == "--lossless") {
+        options.lossless = true;
+    } else if (argument == "--gif-palettes") {
+        options.gifPalette = GifWriter::PerFramePalette;
+    } else if (argument == "--gif-full-frames") {
+        options.gifFrameDifferences = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool recordsGif(const RecordOptions& options)
+{
+    string extension;
+    size_t dot = options.path.find_last_of('.');
+    if (dot != string::npos) {
+        extension = options.path.substr(dot + 1);
+        transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    }
+    return extension == "gif";
+}
+
+unique_ptr<FrameSink> createFrameSink(const RecordOptions& options)
+{
+    if (recordsGif(options)) {
+        return unique_ptr<FrameSink>(new GifSink(options.path, options.gifPalette, options.gifFrameDifferences));
+    }
+    return unique_ptr<FrameSink>(new VideoFileSink(options.path, options.lossless ? VideoFileSink::FFV1 : VideoFileSink::H264));
+}
@@ -0,0 +1,50 @@
+//
+//  RecordOptions.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_RecordOptions_h
+#define pixelsort_RecordOptions_h
+
+#include <string>
+#include <memory>
+
+#include "FrameSink.h"
+#include "GifWriter.h"
+#include "Recorder.h"
+
+// How and where sorted frames are recorded, shared by the app and the
+// command line renderer.
+struct RecordOptions
+{
+    RecordOptions();
+
+    std::string path;
+    Recorder::Speed speed;
+    bool lossless;
+    GifWriter::PaletteMode gifPalette;
+    bool gifFrameDifferences;
+};
+
+// Parse the recording option at argv[i], if it is one, advancing i past its
+// value. Returns false for arguments that aren't recording options.
+//
+// --record <path>   where recordings go, the extension picks the format:
+//                   .gif, or any video container FFmpeg knows (.mp4, .mkv...)
+// --offline         keep every frame, timestamped at 30 fps, instead of
+//                   dropping frames to keep up with the display
+// --lossless        encode videos with FFV1 instead of H.264 (use .mkv)
+// --gif-palettes    compute a palette for every GIF frame instead of
+//                   using the same fixed one
+// --gif-full-frames write whole GIF frames, not only what changed
+bool parseRecordOption(int argc, char const** argv, int& i, RecordOptions& options);
+
+// True if the recording path is a .gif, false for video files.
+bool recordsGif(const RecordOptions& options);
+
+// GifSink for .gif paths, VideoFileSink for anything else.
+std::unique_ptr<FrameSink> createFrameSink(const RecordOptions& options);
+
+#endif
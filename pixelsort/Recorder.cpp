@@ -0,0 +1,205 @@
+//
+//  Recorder.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "Recorder.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace sf;
+
+Recorder::Recorder(size_t capacity_)
+    : capacity(max<size_t>(1, capacity_))
+    , speed(Realtime)
+    , frameRate(30)
+    , recording(false)
+    , stopping(false)
+    , writing(false)
+    , queuedFrames(0)
+    , droppedFrames(0)
+    , writtenFrames(0)
+{
+}
+
+Recorder::~Recorder()
+{
+    stop();
+    wait();
+}
+
+bool Recorder::start(unique_ptr<FrameSink> newSink, Speed speed_, unsigned frameRate_)
+{
+    if (!newSink || isRecording() || isWriting())
+        return false;
+
+    // The previous writer is done, joining it doesn't block
+    wait();
+
+    lock_guard<std::mutex> lock(mutex);
+    sink = move(newSink);
+    speed = speed_;
+    frameRate = max(1u, frameRate_);
+    frameSize = Vector2u(0, 0);
+    slots.clear();
+    freeSlots.clear();
+    queue.clear();
+    recording = true;
+    stopping = false;
+    writing = true;
+    queuedFrames = 0;
+    droppedFrames = 0;
+    writtenFrames = 0;
+
+    writer = thread(&Recorder::writeLoop, this);
+    return true;
+}
+
+bool Recorder::addFrame(const Image& image, Time timestamp)
+{
+    return addFrame(image.getPixelsPtr(), image.getSize(), timestamp);
+}
+
+bool Recorder::addFrame(const Uint8* pixels, const Vector2u& size, Time timestamp)
+{
+    unique_lock<std::mutex> lock(mutex);
+    if (!recording || !pixels || size.x == 0 || size.y == 0)
+        return false;
+
+    // The pool is allocated once, for the size of the first frame
+    if (slots.empty()) {
+        frameSize = size;
+        slots.resize(capacity, vector<Uint8>(static_cast<size_t>(size.x) * size.y * 4));
+        for (size_t i = 0; i < capacity; ++i)
+            freeSlots.push_back(i);
+    } else if (size != frameSize) {
+        droppedFrames++;
+        return false;
+    }
+
+    if (freeSlots.empty()) {
+        if (speed == Realtime) {
+            droppedFrames++;
+            return false;
+        }
+        slotFreed.wait(lock, [this] { return !freeSlots.empty(); });
+    }
+
+    size_t slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    // The slot belongs to us until it is queued, copy without the lock
+    lock.unlock();
+    memcpy(slots[slot].data(), pixels, slots[slot].size());
+    lock.lock();
+
+    if (speed == Offline)
+        timestamp = microseconds(static_cast<Int64>(queuedFrames) * 1000000 / frameRate);
+    queuedFrames++;
+
+    QueuedFrame frame = {slot, timestamp};
+    queue.push_back(frame);
+    frameQueued.notify_one();
+    return true;
+}
+
+void Recorder::stop()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (!recording)
+            return;
+        recording = false;
+        stopping = true;
+    }
+    frameQueued.notify_one();
+}
+
+void Recorder::wait()
+{
+    if (writer.joinable())
+        writer.join();
+}
+
+bool Recorder::isRecording() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    return recording;
+}
+
+bool Recorder::isWriting() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    return writing;
+}
+
+size_t Recorder::getQueueDepth() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+unsigned Recorder::getDroppedFrames() const
+{
+    lock_guard<std::mutex> lock(mutex);
+    return droppedFrames;
+}
+
+void Recorder::writeLoop()
+{
+    unique_lock<std::mutex> lock(mutex);
+    bool begun = false;
+    bool failed = false;
+
+    while (true) {
+        frameQueued.wait(lock, [this] { return !queue.empty() || stopping; });
+        if (queue.empty())
+            break;
+
+        QueuedFrame frame = queue.front();
+        queue.pop_front();
+        Vector2u size = frameSize;
+        lock.unlock();
+
+        if (!begun) {
+            begun = true;
+            if (!sink->begin(size)) {
+                cerr << "Could not start writing " << sink->getPath() << endl;
+                failed = true;
+            }
+        }
+
+        if (!failed && !sink->write(slots[frame.slot].data(), frame.timestamp)) {
+            cerr << "Could not write frame to " << sink->getPath() << endl;
+            failed = true;
+        }
+
+        lock.lock();
+        freeSlots.push_back(frame.slot);
+        writtenFrames++;
+        slotFreed.notify_one();
+    }
+
+    // Recording is over, give the pool memory back until the next one
+    slots.clear();
+    freeSlots.clear();
+    unsigned written = writtenFrames;
+    unsigned dropped = droppedFrames;
+    lock.unlock();
+
+    if (begun && !failed) {
+        sink->end();
+        cout << "Wrote " << written << " frames to " << sink->getPath();
+        if (dropped > 0)
+            cout << " (" << dropped << " dropped)";
+        cout << endl;
+    }
+
+    lock.lock();
+    writing = false;
+}
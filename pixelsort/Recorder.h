@@ -0,0 +1,98 @@
+//
+//  Recorder.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_Recorder_h
+#define pixelsort_Recorder_h
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <SFML/Graphics.hpp>
+
+#include "FrameSink.h"
+
+// Streams recorded frames to a FrameSink from a background thread.
+//
+// Frames are copied into a fixed pool of buffers allocated for the size of
+// the first frame, so memory use is bounded by the pool capacity no matter
+// how long the recording lasts.
+class Recorder
+{
+public:
+    enum Speed
+    {
+        // Frames keep the timestamps they were captured with. When the sink
+        // falls behind and the pool is full, frames are dropped so that the
+        // render thread never waits.
+        Realtime,
+
+        // Every frame is kept and timestamped at a fixed frame rate; the
+        // caller blocks until a buffer is free. Meant for rendering sessions
+        // where the output matters more than the interactive frame rate.
+        Offline
+    };
+
+    explicit Recorder(size_t capacity = 8);
+    ~Recorder();
+
+    // Start a new recording. Fails while the previous one is still being
+    // written, so that the caller never waits for it.
+    bool start(std::unique_ptr<FrameSink> sink, Speed speed = Realtime, unsigned frameRate = 30);
+
+    // Queue a copy of the frame. Returns false if the frame was dropped.
+    bool addFrame(const sf::Image& image, sf::Time timestamp);
+    bool addFrame(const sf::Uint8* pixels, const sf::Vector2u& size, sf::Time timestamp);
+
+    // Stop accepting frames; the queued ones are still written in the background.
+    void stop();
+
+    // Block until every queued frame has been written and the sink closed.
+    void wait();
+
+    bool isRecording() const;
+    // Tell whether the frames of a recording are still being written, stopped or not.
+    bool isWriting() const;
+    size_t getQueueDepth() const;
+    unsigned getDroppedFrames() const;
+
+private:
+    struct QueuedFrame
+    {
+        size_t slot;
+        sf::Time timestamp;
+    };
+
+    void writeLoop();
+
+    size_t capacity;
+    Speed speed;
+    unsigned frameRate;
+
+    std::unique_ptr<FrameSink> sink;
+    sf::Vector2u frameSize;
+    std::vector<std::vector<sf::Uint8>> slots;
+    std::vector<size_t> freeSlots;
+    std::deque<QueuedFrame> queue;
+
+    bool recording;
+    bool stopping;
+    bool writing;
+    unsigned queuedFrames;
+    unsigned droppedFrames;
+    unsigned writtenFrames;
+
+    mutable std::mutex mutex;
+    std::condition_variable frameQueued;
+    std::condition_variable slotFreed;
+    std::thread writer;
+};
+
+#endif
@@ -0,0 +1,233 @@
+//
+//  SharedFrameRing.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "SharedFrameRing.h"
+
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace sf;
+
+static const char RingMagic[8] = {'f', 'a', 'k', 'e', 'r', 'i', 'n', 'g'};
+static const Uint32 RingVersion = 1;
+
+// Slots start on cache lines so that their headers don't share one
+static const Uint64 SlotAlignment = 64;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "sequence numbers must be lock free to be shared between processes");
+
+static Uint64 alignUp(Uint64 value)
+{
+    return (value + SlotAlignment - 1) / SlotAlignment * SlotAlignment;
+}
+
+// shm_open() wants names like "/fakeartist"
+static string sharedMemoryName(const string& name)
+{
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+SharedFrameRing::SharedFrameRing()
+    : memory(nullptr)
+    , length(0)
+    , header(nullptr)
+{
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    close();
+}
+
+bool SharedFrameRing::create(const string& name_, unsigned slotCount, const Vector2u& maxSize)
+{
+    close();
+    if (slotCount == 0 || maxSize.x == 0 || maxSize.y == 0)
+        return false;
+
+    name = sharedMemoryName(name_);
+
+    Uint64 slotCapacity = static_cast<Uint64>(maxSize.x) * maxSize.y * 4;
+    Uint64 slotsOffset = alignUp(sizeof(SharedFrameRingHeader));
+    Uint64 slotStride = alignUp(alignUp(sizeof(SharedFrameSlotHeader)) + slotCapacity);
+    length = static_cast<size_t>(slotsOffset + slotStride * slotCount);
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        cerr << "Could not create the shared memory " << name << endl;
+        return false;
+    }
+
+    if (ftruncate(fd, length) < 0) {
+        cerr << "Could not allocate " << length << " bytes of shared memory" << endl;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        cerr << "Could not map the shared memory " << name << endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+    memory = static_cast<Uint8*>(mapping);
+
+    for (unsigned i = 0; i < slotCount; ++i)
+        new (memory + slotsOffset + slotStride * i) SharedFrameSlotHeader();
+
+    header = new (memory) SharedFrameRingHeader();
+    header->version = RingVersion;
+    header->slotCount = slotCount;
+    header->slotCapacity = slotCapacity;
+    header->slotsOffset = slotsOffset;
+    header->slotStride = slotStride;
+    header->latestSequence.store(0);
+
+    // Readers check the magic last, once the rest of the header is valid
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, RingMagic, sizeof(RingMagic));
+    return true;
+}
+
+void SharedFrameRing::close()
+{
+    if (memory) {
+        munmap(memory, length);
+        shm_unlink(name.c_str());
+    }
+    memory = nullptr;
+    header = nullptr;
+    length = 0;
+}
+
+bool SharedFrameRing::publish(const Uint8* pixels, const Vector2u& size, Time timestamp)
+{
+    Uint64 frameLength = static_cast<Uint64>(size.x) * size.y * 4;
+    if (!header || frameLength == 0 || frameLength > header->slotCapacity)
+        return false;
+
+    Uint64 sequence = header->latestSequence.load(memory_order_relaxed) + 1;
+    Uint8* slotStart = memory + header->slotsOffset + header->slotStride * ((sequence - 1) % header->slotCount);
+    SharedFrameSlotHeader* slot = reinterpret_cast<SharedFrameSlotHeader*>(slotStart);
+
+    // Readers seeing 0 know the slot is being rewritten
+    slot->sequence.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->width = size.x;
+    slot->height = size.y;
+    slot->stride = size.x * 4;
+    slot->timestamp = timestamp.asMicroseconds();
+    memcpy(slotStart + alignUp(sizeof(SharedFrameSlotHeader)), pixels, frameLength);
+
+    slot->sequence.store(sequence, memory_order_release);
+    header->latestSequence.store(sequence, memory_order_release);
+    return true;
+}
+
+bool SharedFrameRing::isOpen() const
+{
+    return memory != nullptr;
+}
+
+SharedFrameRingReader::SharedFrameRingReader()
+    : memory(nullptr)
+    , length(0)
+    , header(nullptr)
+{
+}
+
+SharedFrameRingReader::~SharedFrameRingReader()
+{
+    close();
+}
+
+bool SharedFrameRingReader::open(const string& name)
+{
+    close();
+
+    int fd = shm_open(sharedMemoryName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedFrameRingHeader)) {
+        length = static_cast<size_t>(info.st_size);
+        mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    memory = static_cast<const Uint8*>(mapping);
+    header = reinterpret_cast<const SharedFrameRingHeader*>(memory);
+
+    bool valid = memcmp(header->magic, RingMagic, sizeof(RingMagic)) == 0;
+    atomic_thread_fence(memory_order_acquire);
+    if (!valid || header->version != RingVersion
+        || header->slotsOffset + header->slotStride * header->slotCount > length) {
+        cerr << "The shared memory " << name << " is not a frame ring" << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SharedFrameRingReader::close()
+{
+    if (memory)
+        munmap(const_cast<Uint8*>(memory), length);
+    memory = nullptr;
+    header = nullptr;
+    length = 0;
+}
+
+Uint64 SharedFrameRingReader::getLatestSequence() const
+{
+    return header ? header->latestSequence.load(memory_order_acquire) : 0;
+}
+
+unsigned SharedFrameRingReader::getSlotCount() const
+{
+    return header ? header->slotCount : 0;
+}
+
+bool SharedFrameRingReader::read(Uint64 sequence, vector<Uint8>& pixels, Vector2u& size, Time& timestamp) const
+{
+    if (!header || sequence == 0)
+        return false;
+
+    const Uint8* slotStart = memory + header->slotsOffset + header->slotStride * ((sequence - 1) % header->slotCount);
+    const SharedFrameSlotHeader* slot = reinterpret_cast<const SharedFrameSlotHeader*>(slotStart);
+
+    if (slot->sequence.load(memory_order_acquire) != sequence)
+        return false;
+
+    size = Vector2u(slot->width, slot->height);
+    timestamp = microseconds(slot->timestamp);
+    Uint64 frameLength = static_cast<Uint64>(size.x) * size.y * 4;
+    if (frameLength == 0 || frameLength > header->slotCapacity)
+        return false;
+
+    pixels.resize(static_cast<size_t>(frameLength));
+    memcpy(&pixels[0], slotStart + alignUp(sizeof(SharedFrameSlotHeader)), pixels.size());
+
+    // The frame is only good if nobody started rewriting the slot meanwhile
+    atomic_thread_fence(memory_order_acquire);
+    return slot->sequence.load(memory_order_relaxed) == sequence;
+}
@@ -0,0 +1,97 @@
+//
+//  SharedFrameRing.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_SharedFrameRing_h
+#define pixelsort_SharedFrameRing_h
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+// Ring of frame slots in POSIX shared memory, for handing sorted frames to
+// other local processes (a compositor, a streaming encoder...).
+//
+// One process publishes frames with SharedFrameRing, any number of readers
+// map the ring read-only with SharedFrameRingReader. Publishing never waits
+// for readers: a reader that falls more than slotCount frames behind misses
+// frames, and sees it from the frame sequence numbers.
+//
+// Every slot carries the sequence number of the frame it holds, which is
+// reset to 0 while the slot is being written. Readers check it before and
+// after copying a frame, so a frame overwritten during the copy is detected
+// instead of returned torn.
+
+struct SharedFrameRingHeader
+{
+    char magic[8];
+    sf::Uint32 version;
+    sf::Uint32 slotCount;
+    sf::Uint64 slotCapacity;    // bytes of pixels a slot can hold
+    sf::Uint64 slotsOffset;     // from the start of the shared memory
+    sf::Uint64 slotStride;      // bytes from one slot to the next
+    std::atomic<sf::Uint64> latestSequence;     // 0 until the first frame
+};
+
+struct SharedFrameSlotHeader
+{
+    std::atomic<sf::Uint64> sequence;
+    sf::Uint32 width;
+    sf::Uint32 height;
+    sf::Uint32 stride;          // bytes per row, 4 per RGBA pixel
+    sf::Int64 timestamp;        // microseconds
+};
+
+class SharedFrameRing
+{
+public:
+    SharedFrameRing();
+    ~SharedFrameRing();
+
+    // Create the shared memory, slots fit frames up to maxSize. An existing
+    // ring with the same name is replaced.
+    bool create(const std::string& name, unsigned slotCount, const sf::Vector2u& maxSize);
+    void close();
+
+    // Copy an RGBA frame into the next slot. Frames larger than the slots
+    // are refused.
+    bool publish(const sf::Uint8* pixels, const sf::Vector2u& size, sf::Time timestamp);
+
+    bool isOpen() const;
+
+private:
+    std::string name;
+    sf::Uint8* memory;
+    size_t length;
+    SharedFrameRingHeader* header;
+};
+
+class SharedFrameRingReader
+{
+public:
+    SharedFrameRingReader();
+    ~SharedFrameRingReader();
+
+    bool open(const std::string& name);
+    void close();
+
+    sf::Uint64 getLatestSequence() const;
+    unsigned getSlotCount() const;
+
+    // Copy the frame with the given sequence number. Returns false if it
+    // wasn't published yet, was overwritten already, or got overwritten
+    // while being copied.
+    bool read(sf::Uint64 sequence, std::vector<sf::Uint8>& pixels, sf::Vector2u& size, sf::Time& timestamp) const;
+
+private:
+    const sf::Uint8* memory;
+    size_t length;
+    const SharedFrameRingHeader* header;
+};
+
+#endif
@@ -0,0 +1,31 @@
+//
+//  SortTracing.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "SortTracing.h"
+#include "video/Trace.hpp"
+
+#include "prettysort.h"
+
+// Like sfe::Trace::Zone, a zone that starts while tracing is off is dropped
+static Int64 beginZone(const char*)
+{
+    return sfe::Trace::isEnabled() ? sfe::Trace::now() : -1;
+}
+
+static void endZone(const char* name, Int64 start)
+{
+    if (start >= 0)
+        sfe::Trace::record(name, start, sfe::Trace::now());
+}
+
+void traceSortPasses()
+{
+    SortTraceHooks hooks;
+    hooks.begin = beginZone;
+    hooks.end = endZone;
+    setSortTraceHooks(hooks);
+}
@@ -0,0 +1,16 @@
+//
+//  SortTracing.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_SortTracing_h
+#define pixelsort_SortTracing_h
+
+// Time prettySort() and its passes as sfe::Trace zones, so that they show
+// up in traces and summaries next to the decoding stages. The sorter itself
+// only knows about its trace hooks, not about sfeMovie.
+void traceSortPasses();
+
+#endif
@@ -0,0 +1,229 @@
+//
+//  StateRecording.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "StateRecording.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+using namespace sf;
+
+static const char Magic[4] = {'F', 'A', 'S', 'T'};
+static const Uint16 Version = 2;
+static const size_t FrameLength = 8 + 4 + 3 * 4 + 1 + 1;
+
+// Before sort keys
+static const Uint16 Version1 = 1;
+static const size_t Version1FrameLength = FrameLength - 1;
+
+enum PassFlag
+{
+    DiagonalsFlag = 1 << 0,
+    ColsFlag = 1 << 1,
+    RowsFlag = 1 << 2,
+    CirclesFlag = 1 << 3,
+    SpiralsFlag = 1 << 4,
+    RandomFlag = 1 << 5
+};
+
+static void putInteger(vector<Uint8>& out, Uint64 value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+        out.push_back(static_cast<Uint8>((value >> (8 * i)) & 0xFF));
+}
+
+static Uint64 getInteger(const Uint8* in, int bytes)
+{
+    Uint64 value = 0;
+    for (int i = 0; i < bytes; ++i)
+        value |= static_cast<Uint64>(in[i]) << (8 * i);
+    return value;
+}
+
+// Floats are kept bit for bit, a replayed threshold must be the recorded one
+static void putFloat(vector<Uint8>& out, float value)
+{
+    Uint32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putInteger(out, bits, 4);
+}
+
+static float getFloat(const Uint8* in)
+{
+    Uint32 bits = static_cast<Uint32>(getInteger(in, 4));
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static Uint8 passFlags(const State& state)
+{
+    return (state.diagonals ? DiagonalsFlag : 0) | (state.cols ? ColsFlag : 0) | (state.rows ? RowsFlag : 0)
+        | (state.circles ? CirclesFlag : 0) | (state.spirals ? SpiralsFlag : 0) | (state.random ? RandomFlag : 0);
+}
+
+StateRecorder::StateRecorder()
+    : file(nullptr)
+    , frameCount(0)
+{
+}
+
+StateRecorder::~StateRecorder()
+{
+    close();
+}
+
+bool StateRecorder::open(const string& path, const string& media_)
+{
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        cerr << "Could not write states to " << path << endl;
+        return false;
+    }
+
+    media = media_.substr(0, 0xFFFF);
+    frameCount = 0;
+
+    vector<Uint8> header(Magic, Magic + sizeof(Magic));
+    putInteger(header, Version, 2);
+    putInteger(header, media.size(), 2);
+    header.insert(header.end(), media.begin(), media.end());
+
+    if (fwrite(&header[0], 1, header.size(), file) != header.size()) {
+        cerr << "Could not write states to " << path << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool StateRecorder::isOpen() const
+{
+    return file != nullptr;
+}
+
+void StateRecorder::close()
+{
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+Uint32 StateRecorder::getNextSeed() const
+{
+    return static_cast<Uint32>(frameCount);
+}
+
+bool StateRecorder::write(Time mediaTime, const State& state)
+{
+    if (!file)
+        return false;
+
+    vector<Uint8> record;
+    record.reserve(FrameLength);
+    putInteger(record, static_cast<Uint64>(mediaTime.asMicroseconds()), 8);
+    putInteger(record, getNextSeed(), 4);
+    putFloat(record, state.mouseX);
+    putFloat(record, state.mouseY);
+    putFloat(record, state.time);
+    record.push_back(passFlags(state));
+    record.push_back(static_cast<Uint8>(state.key));
+
+    if (fwrite(&record[0], 1, record.size(), file) != record.size()) {
+        cerr << "Could not write states, stopped recording them" << endl;
+        close();
+        return false;
+    }
+    frameCount++;
+    return true;
+}
+
+const string& StateRecorder::getMedia() const
+{
+    return media;
+}
+
+long StateRecorder::getFrameCount() const
+{
+    return frameCount;
+}
+
+bool StateRecording::loadFromFile(const string& path)
+{
+    media.clear();
+    frames.clear();
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        cerr << "Could not open states " << path << endl;
+        return false;
+    }
+
+    vector<Uint8> data;
+    Uint8 buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + length);
+    fclose(file);
+
+    if (data.size() < 8 || memcmp(&data[0], Magic, sizeof(Magic)) != 0) {
+        cerr << path << " is not a state recording" << endl;
+        return false;
+    }
+    Uint16 version = static_cast<Uint16>(getInteger(&data[4], 2));
+    if (version != Version && version != Version1) {
+        cerr << path << " is a state recording of another version" << endl;
+        return false;
+    }
+    size_t frameLength = version == Version1 ? Version1FrameLength : FrameLength;
+
+    size_t mediaLength = static_cast<size_t>(getInteger(&data[6], 2));
+    size_t offset = 8 + mediaLength;
+    if (offset > data.size()) {
+        cerr << path << " is truncated" << endl;
+        return false;
+    }
+    media.assign(data.begin() + 8, data.begin() + offset);
+
+    // A recording cut short by a crash keeps its complete frames
+    for (; offset + frameLength <= data.size(); offset += frameLength) {
+        const Uint8* in = &data[offset];
+        RecordedState frame;
+        frame.mediaTime = microseconds(static_cast<Int64>(getInteger(in, 8)));
+        frame.seed = static_cast<Uint32>(getInteger(in + 8, 4));
+        frame.state.mouseX = getFloat(in + 12);
+        frame.state.mouseY = getFloat(in + 16);
+        frame.state.time = getFloat(in + 20);
+
+        Uint8 flags = in[24];
+        frame.state.diagonals = (flags & DiagonalsFlag) != 0;
+        frame.state.cols = (flags & ColsFlag) != 0;
+        frame.state.rows = (flags & RowsFlag) != 0;
+        frame.state.circles = (flags & CirclesFlag) != 0;
+        frame.state.spirals = (flags & SpiralsFlag) != 0;
+        frame.state.random = (flags & RandomFlag) != 0;
+
+        if (version != Version1 && in[25] < SortKeyCount)
+            frame.state.key = static_cast<SortKey>(in[25]);
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+const string& StateRecording::getMedia() const
+{
+    return media;
+}
+
+const vector<RecordedState>& StateRecording::getFrames() const
+{
+    return frames;
+}
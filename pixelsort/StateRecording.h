@@ -0,0 +1,82 @@
+//
+//  StateRecording.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_StateRecording_h
+#define pixelsort_StateRecording_h
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+#include "prettysort.h"
+
+// The sorting state of every frame of a session, for playing the session
+// again without a mouse and keyboard: the app records it with --record-state,
+// fakeartist-render --replay sorts the same frames of the same media with
+// the same states, so that two runs take the same path through prettySort().
+//
+// Every frame also gets a seed for rand(), set just before sorting it, which
+// makes the random walks the same from one run to the next.
+//
+// The file is a small header followed by a fixed size record per frame, all
+// little endian:
+//
+//     "FAST", version (Uint16), length of the media name (Uint16), media name
+//     per frame: media time in microseconds (Int64), seed (Uint32),
+//                mouseX, mouseY, time (float bits, Uint32), pass flags (Uint8),
+//                sort key (Uint8, since version 2)
+//
+// Version 1 recordings, without sort keys, are read as sorting raw pixels.
+struct RecordedState
+{
+    sf::Time mediaTime;     // timestamp of the frame in its media
+    sf::Uint32 seed;
+    State state;
+};
+
+class StateRecorder
+{
+public:
+    StateRecorder();
+    ~StateRecorder();
+
+    // Starts a recording of the frames of the given media (a file name)
+    bool open(const std::string& path, const std::string& media);
+    bool isOpen() const;
+    void close();
+
+    // Seed to give srand() before sorting the next frame
+    sf::Uint32 getNextSeed() const;
+
+    // Records the next frame; on error the recording is closed
+    bool write(sf::Time mediaTime, const State& state);
+
+    const std::string& getMedia() const;
+    long getFrameCount() const;
+
+private:
+    FILE* file;
+    std::string media;
+    long frameCount;
+};
+
+class StateRecording
+{
+public:
+    bool loadFromFile(const std::string& path);
+
+    const std::string& getMedia() const;
+    const std::vector<RecordedState>& getFrames() const;
+
+private:
+    std::string media;
+    std::vector<RecordedState> frames;
+};
+
+#endif
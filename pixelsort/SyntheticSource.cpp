@@ -0,0 +1,345 @@
+//
+//  SyntheticSource.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "SyntheticSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+using namespace sf;
+
+// Deterministic on every platform, unlike rand()
+static inline Uint32 mix(Uint32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline float hashFloat(Uint32 x)
+{
+    return (mix(x) >> 8) / 16777216.0f;
+}
+
+static inline Uint8 toComponent(float value)
+{
+    return static_cast<Uint8>(min(255.0f, max(0.0f, value * 255.0f + 0.5f)));
+}
+
+// Adds a layer of value noise to field: random values on a lattice of
+// cells.x * cells.y cells covering the frame, smoothly interpolated. The
+// lattice wraps around so that the noise tiles, which lets frames pan over
+// it forever.
+static void addValueNoise(vector<float>& field, const Vector2u& size, const Vector2u& cells, float amplitude, Uint32 salt)
+{
+    vector<float> lattice(cells.x * cells.y);
+    for (size_t i = 0; i < lattice.size(); ++i)
+        lattice[i] = amplitude * hashFloat(salt ^ mix(static_cast<Uint32>(i)));
+
+    // Columns share their lattice cells and weights from row to row
+    vector<unsigned> x0s(size.x), x1s(size.x);
+    vector<float> xWeights(size.x);
+    for (unsigned x = 0; x < size.x; ++x) {
+        float u = static_cast<float>(x) * cells.x / size.x;
+        float f = u - static_cast<unsigned>(u);
+        x0s[x] = static_cast<unsigned>(u) % cells.x;
+        x1s[x] = (x0s[x] + 1) % cells.x;
+        xWeights[x] = f * f * (3 - 2 * f);
+    }
+
+    for (unsigned y = 0; y < size.y; ++y) {
+        float v = static_cast<float>(y) * cells.y / size.y;
+        float f = v - static_cast<unsigned>(v);
+        float yWeight = f * f * (3 - 2 * f);
+        const float* row0 = &lattice[(static_cast<unsigned>(v) % cells.y) * cells.x];
+        const float* row1 = &lattice[((static_cast<unsigned>(v) + 1) % cells.y) * cells.x];
+
+        float* values = &field[y * size.x];
+        for (unsigned x = 0; x < size.x; ++x) {
+            float top = row0[x0s[x]] + (row0[x1s[x]] - row0[x0s[x]]) * xWeights[x];
+            float bottom = row1[x0s[x]] + (row1[x1s[x]] - row1[x0s[x]]) * xWeights[x];
+            values[x] += top + (bottom - top) * yWeight;
+        }
+    }
+}
+
+// Octaves of value noise, each twice finer than the one before and weaker
+// by the given factor; 0.5 is the 1/f amplitude spectrum of natural images.
+// Values are in [0, 1].
+static vector<float> fractalNoise(const Vector2u& size, unsigned firstCells, unsigned octaves, float persistence, Uint32 salt)
+{
+    vector<float> field(size.x * size.y);
+    float amplitude = 1;
+    float total = 0;
+    unsigned cells = firstCells;
+
+    for (unsigned octave = 0; octave < octaves; ++octave) {
+        Vector2u lattice(cells, max(1u, cells * size.y / size.x));
+        addValueNoise(field, size, lattice, amplitude, mix(salt + octave));
+        total += amplitude;
+        amplitude *= persistence;
+        cells *= 2;
+    }
+
+    for (float& value : field)
+        value /= total;
+    return field;
+}
+
+SyntheticSource::SyntheticSource(const Vector2u& size_, Pattern pattern_, float frameRate_, Uint32 seed_)
+    : size(size_)
+    , pattern(pattern_)
+    , frameRate(frameRate_ > 0 ? frameRate_ : 30)
+    , seed(seed_)
+    , frameCount(0)
+{
+}
+
+bool SyntheticSource::open()
+{
+    frameCount = 0;
+    if (size.x == 0 || size.y == 0)
+        return false;
+
+    if (pattern == Bars && barRow.empty())
+        createBars();
+    if (pattern == Photo && photo.empty())
+        createPhoto();
+    return true;
+}
+
+Vector2u SyntheticSource::getSize() const
+{
+    return size;
+}
+
+bool SyntheticSource::patternFromName(const string& name, Pattern& pattern)
+{
+    static const Pattern patterns[] = {Gradient, Noise, Bars, Photo};
+    for (auto candidate : patterns) {
+        if (name == getPatternName(candidate)) {
+            pattern = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* SyntheticSource::getPatternName(Pattern pattern)
+{
+    switch (pattern) {
+        case Gradient:
+            return "gradient";
+        case Noise:
+            return "noise";
+        case Bars:
+            return "bars";
+        case Photo:
+            return "photo";
+    }
+    return "";
+}
+
+bool SyntheticSource::fill(FrameView& frame)
+{
+    switch (pattern) {
+        case Gradient:
+            drawGradient(frame);
+            break;
+        case Noise:
+            drawNoise(frame);
+            break;
+        case Bars:
+            drawBars(frame);
+            break;
+        case Photo:
+            drawPhoto(frame);
+            break;
+    }
+
+    frame.timestamp = seconds(frameCount / frameRate);
+    frameCount++;
+    return true;
+}
+
+void SyntheticSource::drawGradient(FrameView& frame) const
+{
+    // A full turn of the hues every ten seconds
+    float phase = frameCount / (10 * frameRate) * 2 * static_cast<float>(M_PI);
+
+    // cos(phase + u + v) is split into terms of u and v, so that there's no
+    // trigonometry left in the loop
+    vector<Uint8> reds(size.x);
+    vector<float> uCos(size.x), uSin(size.x);
+    for (unsigned x = 0; x < size.x; ++x) {
+        float u = static_cast<float>(x) / size.x;
+        reds[x] = toComponent(0.5f + 0.5f * sin(phase + 2 * u));
+        uCos[x] = 0.5f * cos(phase + u);
+        uSin[x] = 0.5f * sin(phase + u);
+    }
+
+    for (unsigned y = 0; y < size.y; ++y) {
+        Uint8* pixel = frame.pixels + y * frame.stride;
+        float v = static_cast<float>(y) / size.y;
+        Uint8 green = toComponent(v);
+        float vCos = cos(v);
+        float vSin = sin(v);
+        for (unsigned x = 0; x < size.x; ++x) {
+            pixel[0] = reds[x];
+            pixel[1] = green;
+            pixel[2] = toComponent(0.5f + uCos[x] * vCos - uSin[x] * vSin);
+            pixel[3] = 255;
+            pixel += 4;
+        }
+    }
+}
+
+void SyntheticSource::drawNoise(FrameView& frame) const
+{
+    Uint32 state = mix(seed ^ mix(static_cast<Uint32>(frameCount)));
+
+    for (unsigned y = 0; y < size.y; ++y) {
+        Uint8* pixel = frame.pixels + y * frame.stride;
+        for (unsigned x = 0; x < size.x; ++x) {
+            // xorshift32, a hash per pixel would be needlessly slow at 4K
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            pixel[0] = static_cast<Uint8>(state);
+            pixel[1] = static_cast<Uint8>(state >> 8);
+            pixel[2] = static_cast<Uint8>(state >> 16);
+            pixel[3] = 255;
+            pixel += 4;
+        }
+    }
+}
+
+void SyntheticSource::createBars()
+{
+    barRow.resize(size.x * 3);
+
+    Uint32 salt = mix(seed ^ 0xba75);
+    unsigned x = 0;
+    for (Uint32 bar = 0; x < size.x; ++bar) {
+        // Mostly narrow bars with a few wide ones
+        float r = hashFloat(salt + bar * 4);
+        unsigned width = 1 + static_cast<unsigned>(r * r * r * size.x / 6);
+
+        // A dark bar every so often breaks the frame into segments
+        float brightness = hashFloat(salt + bar * 4 + 1) < 0.2f ? 0.05f : 0.3f + 0.7f * hashFloat(salt + bar * 4 + 2);
+        float tint = hashFloat(salt + bar * 4 + 3);
+
+        Uint8 color[3] = {
+            toComponent(brightness * (0.6f + 0.4f * tint)),
+            toComponent(brightness),
+            toComponent(brightness * (1.0f - 0.4f * tint))
+        };
+        for (unsigned end = min(size.x, x + width); x < end; ++x)
+            memcpy(&barRow[x * 3], color, 3);
+    }
+}
+
+void SyntheticSource::drawBars(FrameView& frame) const
+{
+    // The bars cross the frame in about eight seconds
+    unsigned offset = static_cast<unsigned>(frameCount * size.x / (8 * frameRate)) % size.x;
+
+    for (unsigned y = 0; y < size.y; ++y) {
+        Uint8* pixel = frame.pixels + y * frame.stride;
+        unsigned dim = 256 - 192 * y / size.y;
+        for (unsigned x = 0; x < size.x; ++x) {
+            const Uint8* color = &barRow[((x + offset) % size.x) * 3];
+            pixel[0] = static_cast<Uint8>(color[0] * dim >> 8);
+            pixel[1] = static_cast<Uint8>(color[1] * dim >> 8);
+            pixel[2] = static_cast<Uint8>(color[2] * dim >> 8);
+            pixel[3] = 255;
+            pixel += 4;
+        }
+    }
+}
+
+void SyntheticSource::createPhoto()
+{
+    // Octaves from a few cells across down to cells of about two pixels
+    unsigned octaves = 1;
+    while ((3u << octaves) * 2 < size.x && octaves < 12)
+        octaves++;
+
+    // Texture falls off a bit slower than 1/f, value noise is smoother than
+    // the real thing
+    Uint32 salt = mix(seed ^ 0xf070);
+    vector<float> luminance = fractalNoise(size, 3, octaves, 0.6f, salt);
+    vector<float> regions = fractalNoise(size, 6, 4, 0.5f, salt + 100);
+    vector<float> redCast = fractalNoise(size, 2, 2, 0.5f, salt + 200);
+    vector<float> blueCast = fractalNoise(size, 2, 2, 0.5f, salt + 300);
+
+    // Hard edged regions, like objects in a scene, each with its own light
+    // and tint
+    static const unsigned Regions = 8;
+    float lights[Regions], redTints[Regions], blueTints[Regions];
+    for (unsigned region = 0; region < Regions; ++region) {
+        lights[region] = 0.8f * hashFloat(salt + 400 + region) - 0.4f;
+        redTints[region] = 0.4f * hashFloat(salt + 500 + region) - 0.2f;
+        blueTints[region] = 0.4f * hashFloat(salt + 600 + region) - 0.2f;
+    }
+
+    vector<Uint8> regionOf(luminance.size());
+    for (size_t i = 0; i < luminance.size(); ++i) {
+        float position = min(0.999f, max(0.0f, (regions[i] - 0.3f) / 0.4f));
+        regionOf[i] = static_cast<Uint8>(position * Regions);
+        luminance[i] += lights[regionOf[i]];
+    }
+
+    // Equalize, then bend the histogram towards the shadows
+    static const unsigned Bins = 1024;
+    float low = *min_element(luminance.begin(), luminance.end());
+    float high = *max_element(luminance.begin(), luminance.end());
+    float scale = high > low ? (Bins - 1) / (high - low) : 0;
+
+    vector<float> curve(Bins);
+    for (float value : luminance)
+        curve[static_cast<unsigned>((value - low) * scale)] += 1;
+    float cumulated = 0;
+    for (unsigned bin = 0; bin < Bins; ++bin) {
+        cumulated += curve[bin];
+        curve[bin] = pow(cumulated / luminance.size(), 1.4f);
+    }
+
+    photo.resize(size.x * size.y * 4);
+    for (size_t i = 0; i < luminance.size(); ++i) {
+        // A little sensor grain, which splits segments near the threshold
+        float grain = 0.03f * (hashFloat(salt ^ mix(static_cast<Uint32>(i))) - 0.5f);
+        float value = curve[static_cast<unsigned>((luminance[i] - low) * scale)] + grain;
+        unsigned region = regionOf[i];
+
+        Uint8* pixel = &photo[i * 4];
+        pixel[0] = toComponent(value * (1 + 0.5f * (redCast[i] - 0.5f) + redTints[region]));
+        pixel[1] = toComponent(value);
+        pixel[2] = toComponent(value * (1 + 0.5f * (blueCast[i] - 0.5f) + blueTints[region]));
+        pixel[3] = 255;
+    }
+}
+
+void SyntheticSource::drawPhoto(FrameView& frame) const
+{
+    // A slow diagonal pan, a frame's width every twenty seconds
+    unsigned offsetX = static_cast<unsigned>(frameCount * size.x / (20 * frameRate)) % size.x;
+    unsigned offsetY = static_cast<unsigned>(frameCount * size.y / (40 * frameRate)) % size.y;
+
+    for (unsigned y = 0; y < size.y; ++y) {
+        const Uint8* row = &photo[((y + offsetY) % size.y) * size.x * 4];
+        Uint8* pixels = frame.pixels + y * frame.stride;
+        unsigned split = size.x - offsetX;
+        memcpy(pixels, row + offsetX * 4, split * 4);
+        memcpy(pixels + split * 4, row, offsetX * 4);
+    }
+}
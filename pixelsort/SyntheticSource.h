@@ -0,0 +1,78 @@
+//
+//  SyntheticSource.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_SyntheticSource_h
+#define pixelsort_SyntheticSource_h
+
+#include <string>
+#include <vector>
+
+#include "FrameSource.h"
+
+// Generated test patterns, drawn straight into the pool buffer. They need
+// no file nor camera, and frame n of a pattern is the same on every run and
+// every machine for a given size and seed, which makes them the input of
+// choice for benchmarks.
+//
+// The patterns bracket what the sorter sees on real footage:
+//
+// Gradient  smooth color ramps drifting over time; a few segments spanning
+//           the whole frame, the cheapest case
+// Noise     independent random pixels every frame; segments of a pixel or
+//           two, the most expensive case per pixel
+// Bars      vertical bars of random widths, brightness and colors scrolling
+//           sideways, dimmed from top to bottom; segment lengths set by the
+//           bar widths
+// Photo     fractal noise with a 1/f falloff like natural images, hard edged
+//           light and shadow regions and a slow color cast, slowly panning.
+//           Its brightness histogram leans to the dark side like most
+//           footage, so that the lengths of the segments found at any
+//           threshold follow what movies and the webcam give.
+class SyntheticSource : public FrameSource
+{
+public:
+    enum Pattern
+    {
+        Gradient,
+        Noise,
+        Bars,
+        Photo
+    };
+
+    SyntheticSource(const sf::Vector2u& size, Pattern pattern = Photo, float frameRate = 30, sf::Uint32 seed = 1);
+
+    bool open();
+    sf::Vector2u getSize() const;
+
+    // "gradient", "noise", "bars" or "photo"
+    static bool patternFromName(const std::string& name, Pattern& pattern);
+    static const char* getPatternName(Pattern pattern);
+
+protected:
+    bool fill(FrameView& frame);
+
+private:
+    void drawGradient(FrameView& frame) const;
+    void drawNoise(FrameView& frame) const;
+    void drawBars(FrameView& frame) const;
+    void drawPhoto(FrameView& frame) const;
+
+    void createBars();
+    void createPhoto();
+
+    sf::Vector2u size;
+    Pattern pattern;
+    float frameRate;
+    sf::Uint32 seed;
+    long frameCount;
+
+    // Generated once by open(), frames scroll over them
+    std::vector<sf::Uint8> barRow;      // RGB, size.x pixels
+    std::vector<sf::Uint8> photo;       // RGBA, size.x * size.y pixels, tiles
+};
+
+#endif
@@ -0,0 +1,299 @@
+//
+//  VideoFileSink.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+}
+
+#include "VideoFileSink.h"
+#include "video/Demuxer.hpp"
+
+#include <iostream>
+
+using namespace std;
+using namespace sf;
+
+static const AVRational MillisecondTimeBase = {1, 1000};
+
+VideoFileSink::VideoFileSink(const string& path_, Codec codec_)
+    : path(path_)
+    , codec(codec_)
+    , formatContext(nullptr)
+    , stream(nullptr)
+    , frame(nullptr)
+    , swsContext(nullptr)
+    , lastPts(-1)
+    , headerWritten(false)
+{
+}
+
+VideoFileSink::~VideoFileSink()
+{
+    cleanup();
+}
+
+bool VideoFileSink::begin(const Vector2u& size)
+{
+    // Recordings start on the recorder thread, maybe while a movie opens
+    sfe::Demuxer::loadFFmpeg();
+
+    sourceSize = size;
+    lastPts = -1;
+
+    // yuv420p needs even dimensions, the last row and column are cropped
+    int width = static_cast<int>(codec == H264 ? size.x & ~1u : size.x);
+    int height = static_cast<int>(codec == H264 ? size.y & ~1u : size.y);
+    if (width <= 0 || height <= 0) {
+        cerr << "Can't encode " << size.x << "x" << size.y << " frames to " << path << endl;
+        return false;
+    }
+
+    avformat_alloc_output_context2(&formatContext, nullptr, nullptr, path.c_str());
+    if (!formatContext) {
+        cerr << "Unknown video format for " << path << endl;
+        return false;
+    }
+
+    AVCodec* encoder = avcodec_find_encoder(codec == H264 ? AV_CODEC_ID_H264 : AV_CODEC_ID_FFV1);
+    if (!encoder) {
+        cerr << "No " << (codec == H264 ? "H.264" : "FFV1") << " encoder available" << endl;
+        cleanup();
+        return false;
+    }
+
+    stream = avformat_new_stream(formatContext, encoder);
+    if (!stream) {
+        cerr << "Could not create video stream for " << path << endl;
+        cleanup();
+        return false;
+    }
+
+    AVCodecContext* context = stream->codec;
+    context->width = width;
+    context->height = height;
+    context->time_base = MillisecondTimeBase;
+    stream->time_base = MillisecondTimeBase;
+    context->thread_count = 0;
+
+    AVPixelFormat pixelFormat;
+    if (codec == H264) {
+        pixelFormat = PIX_FMT_YUV420P;
+        context->gop_size = 30;
+        av_opt_set(context->priv_data, "preset", "veryfast", 0);
+        av_opt_set(context->priv_data, "crf", "18", 0);
+    } else {
+        pixelFormat = PIX_FMT_0RGB32;
+        context->gop_size = 1;
+    }
+    context->pix_fmt = pixelFormat;
+
+    if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+        context->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+    if (avcodec_open2(context, encoder, nullptr) < 0) {
+        cerr << "Could not open the " << encoder->name << " encoder for " << path << endl;
+        cleanup();
+        return false;
+    }
+
+    for (size_t i = 0; i < passthroughSources.size(); ++i) {
+        const AVStream* source = passthroughSources[i];
+        if (avformat_query_codec(formatContext->oformat, source->codec->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+            cerr << "Leaving out the " << avcodec_get_name(source->codec->codec_id) << " stream, "
+                 << formatContext->oformat->name << " can't hold it" << endl;
+            continue;
+        }
+
+        AVStream* copy = avformat_new_stream(formatContext, nullptr);
+        if (!copy || avcodec_copy_context(copy->codec, source->codec) < 0) {
+            cerr << "Could not copy a stream to " << path << endl;
+            cleanup();
+            return false;
+        }
+        copy->codec->codec_tag = 0;
+        copy->time_base = source->time_base;
+        if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+            copy->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+        passthroughStreams[source] = copy;
+    }
+
+    if (!(formatContext->oformat->flags & AVFMT_NOFILE) && avio_open(&formatContext->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+        cerr << "Could not open " << path << " for writing" << endl;
+        cleanup();
+        return false;
+    }
+
+    if (avformat_write_header(formatContext, nullptr) < 0) {
+        cerr << "Could not write the header of " << path << endl;
+        cleanup();
+        return false;
+    }
+    headerWritten = true;
+
+    frame = av_frame_alloc();
+    if (!frame || av_image_alloc(frame->data, frame->linesize, width, height, pixelFormat, 32) < 0) {
+        cerr << "Could not allocate the encoder frame" << endl;
+        cleanup();
+        return false;
+    }
+    frame->format = pixelFormat;
+    frame->width = width;
+    frame->height = height;
+
+    swsContext = sws_getCachedContext(nullptr, width, height, PIX_FMT_RGBA,
+                                      width, height, pixelFormat,
+                                      SWS_POINT, nullptr, nullptr, nullptr);
+    if (!swsContext) {
+        cerr << "Could not create the pixel format converter" << endl;
+        cleanup();
+        return false;
+    }
+
+    return true;
+}
+
+bool VideoFileSink::write(const Uint8* pixels, Time timestamp)
+{
+    if (!frame)
+        return false;
+
+    const uint8_t* sourceData[1] = {pixels};
+    const int sourceLinesize[1] = {static_cast<int>(sourceSize.x * 4)};
+    sws_scale(swsContext, sourceData, sourceLinesize, 0, frame->height, frame->data, frame->linesize);
+
+    // Frames captured within the same millisecond still need increasing timestamps
+    Int64 pts = timestamp.asMicroseconds() / 1000;
+    if (pts <= lastPts)
+        pts = lastPts + 1;
+    lastPts = pts;
+    frame->pts = pts;
+
+    return encode(frame);
+}
+
+void VideoFileSink::end()
+{
+    if (frame) {
+        // Drain the frames the encoder kept for lookahead
+        if (stream->codec->codec->capabilities & CODEC_CAP_DELAY) {
+            while (encode(nullptr))
+                ;
+        }
+    }
+
+    if (headerWritten && av_write_trailer(formatContext) < 0)
+        cerr << "Could not finish writing " << path << endl;
+    headerWritten = false;
+
+    cleanup();
+}
+
+string VideoFileSink::getPath() const
+{
+    return path;
+}
+
+void VideoFileSink::addPassthroughStream(const AVStream& source)
+{
+    passthroughSources.push_back(&source);
+}
+
+bool VideoFileSink::writePassthroughPacket(const AVStream& source, const AVPacket& packet)
+{
+    map<const AVStream*, AVStream*>::const_iterator copy = passthroughStreams.find(&source);
+    if (!headerWritten || copy == passthroughStreams.end())
+        return false;
+
+    AVPacket output;
+    if (av_copy_packet(&output, &packet) < 0)
+        return false;
+
+    if (output.pts != AV_NOPTS_VALUE)
+        output.pts = av_rescale_q(output.pts, source.time_base, copy->second->time_base);
+    if (output.dts != AV_NOPTS_VALUE)
+        output.dts = av_rescale_q(output.dts, source.time_base, copy->second->time_base);
+    output.duration = static_cast<int>(av_rescale_q(output.duration, source.time_base, copy->second->time_base));
+    output.stream_index = copy->second->index;
+    output.pos = -1;
+
+    int err = av_interleaved_write_frame(formatContext, &output);
+    av_free_packet(&output);
+    if (err < 0) {
+        cerr << "Error while copying a packet to " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Returns true if a packet was written
+bool VideoFileSink::encode(AVFrame* input)
+{
+    AVPacket packet;
+    av_init_packet(&packet);
+    packet.data = nullptr;
+    packet.size = 0;
+
+    int gotPacket = 0;
+    if (avcodec_encode_video2(stream->codec, &packet, input, &gotPacket) < 0) {
+        cerr << "Error while encoding a frame of " << path << endl;
+        return false;
+    }
+    if (!gotPacket)
+        return input != nullptr;
+
+    // The muxer may have picked another time base while writing the header
+    if (packet.pts != AV_NOPTS_VALUE)
+        packet.pts = av_rescale_q(packet.pts, stream->codec->time_base, stream->time_base);
+    if (packet.dts != AV_NOPTS_VALUE)
+        packet.dts = av_rescale_q(packet.dts, stream->codec->time_base, stream->time_base);
+    packet.duration = static_cast<int>(av_rescale_q(packet.duration, stream->codec->time_base, stream->time_base));
+    packet.stream_index = stream->index;
+
+    int err = av_interleaved_write_frame(formatContext, &packet);
+    av_free_packet(&packet);
+    if (err < 0) {
+        cerr << "Error while writing a frame of " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+void VideoFileSink::cleanup()
+{
+    if (headerWritten) {
+        av_write_trailer(formatContext);
+        headerWritten = false;
+    }
+
+    if (swsContext) {
+        sws_freeContext(swsContext);
+        swsContext = nullptr;
+    }
+
+    if (frame) {
+        av_freep(&frame->data[0]);
+        av_frame_free(&frame);
+    }
+
+    if (stream) {
+        avcodec_close(stream->codec);
+        stream = nullptr;
+    }
+    passthroughStreams.clear();
+
+    if (formatContext) {
+        if (!(formatContext->oformat->flags & AVFMT_NOFILE) && formatContext->pb)
+            avio_closep(&formatContext->pb);
+        avformat_free_context(formatContext);
+        formatContext = nullptr;
+    }
+}
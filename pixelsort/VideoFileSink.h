@@ -0,0 +1,75 @@
+//
+//  VideoFileSink.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_VideoFileSink_h
+#define pixelsort_VideoFileSink_h
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <SFML/System.hpp>
+
+#include "FrameSink.h"
+
+struct AVFormatContext;
+struct AVStream;
+struct AVPacket;
+struct AVFrame;
+struct SwsContext;
+
+// FrameSink encoding recorded frames to a video file with libavcodec.
+// The container is guessed from the file extension (.mp4, .mov, .mkv...).
+// Timestamps are kept with millisecond precision, so realtime recordings
+// play back at the pace they were captured.
+class VideoFileSink : public FrameSink
+{
+public:
+    enum Codec
+    {
+        H264,   // yuv420p, small files, dimensions rounded down to even
+        FFV1    // lossless, needs a container that supports it, like .mkv
+    };
+
+    explicit VideoFileSink(const std::string& path, Codec codec = H264);
+    ~VideoFileSink();
+
+    bool begin(const sf::Vector2u& size);
+    bool write(const sf::Uint8* pixels, sf::Time timestamp);
+    void end();
+
+    std::string getPath() const;
+
+    // Copy a stream of another file, like the soundtrack of the movie being
+    // rendered, without decoding it. Must be called before begin(); streams
+    // the container can't hold are left out.
+    void addPassthroughStream(const AVStream& source);
+
+    // Write a packet of a stream given to addPassthroughStream(), with
+    // timestamps in the time base of that stream.
+    bool writePassthroughPacket(const AVStream& source, const AVPacket& packet);
+
+private:
+    bool encode(AVFrame* frame);
+    void cleanup();
+
+    std::string path;
+    Codec codec;
+
+    AVFormatContext* formatContext;
+    AVStream* stream;
+    AVFrame* frame;
+    SwsContext* swsContext;
+    sf::Vector2u sourceSize;
+    sf::Int64 lastPts;
+    bool headerWritten;
+
+    std::vector<const AVStream*> passthroughSources;
+    std::map<const AVStream*, AVStream*> passthroughStreams;
+};
+
+#endif
@@ -0,0 +1,67 @@
+//
+//  WebcamSource.cpp
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "WebcamSource.h"
+
+#include <iostream>
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+using namespace std;
+using namespace sf;
+
+WebcamSource::WebcamSource(int device_)
+    : device(device_)
+{
+}
+
+WebcamSource::~WebcamSource()
+{
+    if (capture.isOpened())
+        capture.release();
+}
+
+bool WebcamSource::open()
+{
+    if (!capture.open(device)) {
+        cerr << "Could not open camera " << device << endl;
+        return false;
+    }
+
+    // Cameras don't always honour the size they report, the first frame
+    // tells the truth
+    capture >> frameBGR;
+    if (frameBGR.empty()) {
+        cerr << "Camera " << device << " doesn't deliver any frame" << endl;
+        capture.release();
+        return false;
+    }
+
+    size = Vector2u(frameBGR.cols, frameBGR.rows);
+    clock.restart();
+    return true;
+}
+
+Vector2u WebcamSource::getSize() const
+{
+    return size;
+}
+
+bool WebcamSource::fill(FrameView& frame)
+{
+    capture >> frameBGR;
+    if (frameBGR.empty() || frameBGR.cols != static_cast<int>(size.x) || frameBGR.rows != static_cast<int>(size.y))
+        return false;
+
+    // A Mat over the pool buffer, cvtColor() writes into it as it has the
+    // right size and type already
+    cv::Mat frameRGBA(frameBGR.rows, frameBGR.cols, CV_8UC4, frame.pixels, frame.stride);
+    cv::cvtColor(frameBGR, frameRGBA, cv::COLOR_BGR2RGBA);
+
+    frame.timestamp = clock.getElapsedTime();
+    return true;
+}
@@ -0,0 +1,37 @@
+//
+//  WebcamSource.h
+//  pixelsort
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef pixelsort_WebcamSource_h
+#define pixelsort_WebcamSource_h
+
+#include "FrameSource.h"
+
+#include "opencv2/highgui/highgui.hpp"
+
+// Frames of a camera through OpenCV. The BGR to RGBA conversion writes
+// straight into the pool buffer.
+class WebcamSource : public FrameSource
+{
+public:
+    explicit WebcamSource(int device = 0);
+    ~WebcamSource();
+
+    bool open();
+    sf::Vector2u getSize() const;
+
+protected:
+    bool fill(FrameView& frame);
+
+private:
+    int device;
+    cv::VideoCapture capture;
+    cv::Mat frameBGR;
+    sf::Vector2u size;
+    sf::Clock clock;
+};
+
+#endif
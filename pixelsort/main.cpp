@@ -2,7 +2,10 @@
 #include <SFML/Graphics.hpp>
 #include "video/Movie.hpp"
 
+#include <cctype>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include <vector>
 #include <iostream>
@@ -16,57 +19,38 @@
 
 #include "ResourcePath.hpp"
 #include "platform.h"
-
-#include <Magick++.h>
-
-#include "opencv2/imgproc/imgproc.hpp"
-#include "opencv2/highgui/highgui.hpp"
+#include "PerformanceHud.h"
+#include "Playlist.h"
+#include "Recorder.h"
+#include "RecordOptions.h"
+#include "SharedFrameRing.h"
+#include "SortTracing.h"
+#include "FrameProfile.h"
+#include "MetricsWriter.h"
+#include "StateRecording.h"
+#include "MovieSource.h"
+#include "WebcamSource.h"
+#include "ImageSequenceSource.h"
+#include "SyntheticSource.h"
+#include "video/Trace.hpp"
 
 #include "prettysort.h"
+#include "sortdispatch.h"
 
 
 using namespace sf;
 using namespace std;
 
-Magick::Image sfmlToMagick(sf::Image& sfImage)
-{
-    const sf::Vector2u size(sfImage.getSize());
-    Magick::Image image(Magick::Geometry(size.x, size.y));
-    image.type(Magick::ImageType::TrueColorType);
-    image.modifyImage();
-    return image;
-}
-
 namespace sfe {
     void dumpAvailableDemuxers();
     void dumpAvailableDecoders();
 }
 
-struct Media
-{
-    enum MediaType
-    {
-        IMAGE,
-        MOVIE,
-        WEBCAM
-    };
-    
-    MediaType type;
-    string filename;
-};
-
 float clamp(float v, float minval=0.0f, float maxval=1.0f)
 {
     return min(maxval, max(minval, v));
 }
 
-void writeThread(vector<Magick::Image> images, std::string path)
-{
-    cout << "Writing " << path << endl;
-    Magick::writeImages(begin(images), end(images), path);
-    cout << "...finished!" << endl;
-}
-
 float vectorLength(const Vector2f& vec) {
     return sqrt(vec.x * vec.x + vec.y * vec.y);
 }
@@ -75,6 +59,104 @@ Vector2f vectorNormalized(const Vector2f& v) {
   return v / vectorLength(v);
 }
 
+// FAKEARTIST_INPUT=default|mmap|buffered selects how movie files are read,
+// for comparing FFmpeg's own I/O against our custom inputs.
+static sfe::InputMode inputModeFromEnvironment()
+{
+    const char* value = getenv("FAKEARTIST_INPUT");
+    string mode = value ? value : "default";
+
+    if (mode == "mmap") {
+        return sfe::MemoryMappedInput;
+    } else if (mode == "buffered") {
+        return sfe::LargeBufferInput;
+    } else if (mode != "default") {
+        cerr << "Unknown FAKEARTIST_INPUT '" << mode << "', using default input" << endl;
+    }
+    return sfe::DefaultInput;
+}
+
+// Where sorted frames are published for other processes, see SharedFrameRing.
+struct ShareOptions
+{
+    ShareOptions() : slotCount(4), maxSize(1920, 1080) {}
+
+    string name;
+    unsigned slotCount;
+    Vector2u maxSize;
+};
+
+// --shm <name>        publish every sorted frame to a shared memory ring
+// --shm-slots <n>     frames kept in the ring, 4 by default
+// --shm-size <WxH>    largest frame the ring can hold, 1920x1080 by default
+static bool parseShareOption(int argc, char const** argv, int& i, ShareOptions& options)
+{
+    string argument = argv[i];
+    if (argument == "--shm" && i + 1 < argc) {
+        options.name = argv[++i];
+    } else if (argument == "--shm-slots" && i + 1 < argc) {
+        options.slotCount = max(1, atoi(argv[++i]));
+    } else if (argument == "--shm-size" && i + 1 < argc) {
+        unsigned width = 0, height = 0;
+        if (sscanf(argv[++i], "%ux%u", &width, &height) == 2 && width > 0 && height > 0) {
+            options.maxSize = Vector2u(width, height);
+        } else {
+            cerr << "Ignoring invalid --shm-size " << argv[i] << endl;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// --test-pattern adds the generated test patterns to the playlist, to try
+// the sorts without any movie or camera
+// --record-state <file> records the sorting state of every frame of the first
+// movie shown, for fakeartist-render --replay, see StateRecording.h
+// --trace <file> records where the time of frames goes, and writes it as a
+// Chrome trace when T is pressed and on exit, see video/Trace.hpp
+// --hud starts with the performance overlay shown, H toggles it
+// --metrics <file> appends the profile of every frame to a file or named
+// pipe as JSON lines, see MetricsWriter.h
+// --calibrate-sort times the sort backends again instead of using the ones
+// calibrated on a previous run, see sortdispatch.h
+static void parseArguments(int argc, char const** argv, RecordOptions& recordOptions, ShareOptions& shareOptions,
+                           bool& testPattern, string& stateRecordingPath, string& tracePath, bool& showHud,
+                           string& metricsPath, bool& calibrateSort)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--test-pattern") {
+            testPattern = true;
+        } else if (string(argv[i]) == "--record-state" && i + 1 < argc) {
+            stateRecordingPath = argv[++i];
+        } else if (string(argv[i]) == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (string(argv[i]) == "--hud") {
+            showHud = true;
+        } else if (string(argv[i]) == "--metrics" && i + 1 < argc) {
+            metricsPath = argv[++i];
+        } else if (string(argv[i]) == "--calibrate-sort") {
+            calibrateSort = true;
+        } else if (!parseRecordOption(argc, argv, i, recordOptions) && !parseShareOption(argc, argv, i, shareOptions)) {
+            cerr << "Ignoring unknown argument " << argv[i] << endl;
+        }
+    }
+}
+
+static bool isImageFile(const string& filename)
+{
+    static const char* extensions[] = {".png", ".jpg", ".jpeg", ".bmp", ".tga"};
+
+    string lowercase = filename;
+    transform(lowercase.begin(), lowercase.end(), lowercase.begin(), ::tolower);
+    for (auto extension : extensions) {
+        size_t length = strlen(extension);
+        if (lowercase.size() > length && lowercase.compare(lowercase.size() - length, length, extension) == 0)
+            return true;
+    }
+    return false;
+}
+
 static void updateStateFromKeyboard(State& state, Keyboard::Key keyCode)
 {
     switch (keyCode) {
@@ -96,13 +178,45 @@ static void updateStateFromKeyboard(State& state, Keyboard::Key keyCode)
         case Keyboard::Num6:
             state.random = !state.random;
             break;
+        case Keyboard::K:
+            state.key = static_cast<SortKey>((state.key + 1) % SortKeyCount);
+            cout << "Sorting by " << getSortKeyName(state.key) << endl;
+            break;
         default:
             break;
     }
 }
 
-int main(int, char const**)
+int main(int argc, char const** argv)
 {
+    RecordOptions recordOptions;
+    ShareOptions shareOptions;
+    bool testPattern = false;
+    string stateRecordingPath;
+    string tracePath;
+    bool showHud = false;
+    string metricsPath;
+    bool calibrateSort = false;
+    parseArguments(argc, argv, recordOptions, shareOptions, testPattern, stateRecordingPath, tracePath, showHud,
+                   metricsPath, calibrateSort);
+
+    useSortDispatch(cachePath("fakeartist-sort-dispatch.txt"), calibrateSort);
+    traceSortPasses();
+
+    // Also what the HUD profile sums up, see FrameProfiler
+    sfe::Trace::setThreadName("main");
+    if (!tracePath.empty())
+        sfe::Trace::setEnabled(true);
+
+    SharedFrameRing frameRing;
+    if (!shareOptions.name.empty()) {
+        if (frameRing.create(shareOptions.name, shareOptions.slotCount, shareOptions.maxSize)) {
+            cout << "Publishing frames to " << shareOptions.name << endl;
+        } else {
+            cerr << "Not publishing frames" << endl;
+        }
+    }
+
     RenderWindow window(VideoMode(1024, 768), "fake artist");
     
     Image icon;
@@ -112,7 +226,7 @@ int main(int, char const**)
     window.setIcon(icon.getSize().x, icon.getSize().y, icon.getPixelsPtr());
     window.setFramerateLimit(30);
 
-    sfe::Movie movie;
+    shared_ptr<sfe::Movie> movie;
 
     Texture texture;
     Sprite displaySprite;
@@ -124,27 +238,43 @@ int main(int, char const**)
     medias.push_back(webcamMedia);
 
     for (auto movieFilename : findMovies()) {
-        Media media = {Media::MOVIE, movieFilename};
+        Media media = {isImageFile(movieFilename) ? Media::IMAGE : Media::MOVIE, movieFilename};
         medias.push_back(media);
     }
+
+    if (testPattern) {
+        for (auto pattern : {SyntheticSource::Photo, SyntheticSource::Bars, SyntheticSource::Gradient, SyntheticSource::Noise}) {
+            Media syntheticMedia = {Media::SYNTHETIC, SyntheticSource::getPatternName(pattern)};
+            medias.push_back(syntheticMedia);
+        }
+    }
     
-    Int32 mediaIndex = 0;
-    Int32 oldMediaIndex;
+    Playlist playlist(medias, 3, inputModeFromEnvironment());
+    size_t oldMediaIndex = 0;
+    bool waitingForMovie = false;
 
     sf::Clock globalClock;
     State state;
     bool updateMedia = true;
     bool firstUpdate = true;
 
-    Image prettyImage;
-    
-    Magick::InitializeMagick(nullptr);
-    vector<Image> animated;
-    bool recording = false;
+    unique_ptr<FrameSource> source;
+    FrameView frame;
+
+    Recorder recorder;
+    sf::Clock recordClock;
+    bool waitingForRecorder = false;
+    StateRecorder stateRecorder;
+
+    FrameProfiler profiler;
+    PerformanceHud hud;
+    showHud = showHud && hud.loadFont();
+
+    MetricsWriter metrics;
+    if (!metricsPath.empty() && metrics.open(metricsPath))
+        cout << "Writing metrics to " << metricsPath << endl;
+    profiler.setEnabled(showHud || metrics.isOpen());
 
-    cv::VideoCapture webcam;
-    cv::Mat frameRGB, frameRGBA;
-    
     sf::Sprite sprite;
     
     while (window.isOpen()) {
@@ -155,31 +285,17 @@ int main(int, char const**)
                 window.close();
             }
             
-            if (!recording && event.type == Event::KeyPressed && event.key.code == Keyboard::Space) {
-                cout << "Starting to record." << endl;
-                recording = true;
-            } else if (recording && event.type == Event::KeyReleased && event.key.code == Keyboard::Space) {
-                if (animated.size() > 0) {
-                    string path = "/tmp/test.gif";
-                    cout << "Writing " << animated.size() << " images to " << path << endl;
-
-                    vector<Magick::Image> magickAnimated;
-                    for (auto sfImage : animated) {
-                        const void* pixels = getWritablePixels(sfImage);
-                        
-                        Magick::Image magickImage(sfImage.getSize().x, sfImage.getSize().y, "RGBA", Magick::StorageType::CharPixel, pixels);
-                        magickImage.animationDelay(1);
-                        magickAnimated.push_back(magickImage);
-                    }
-                    thread saveThread(bind(writeThread, magickAnimated, path));
-                    saveThread.detach();
-                    animated.resize(0);
+            if (!recorder.isRecording() && event.type == Event::KeyPressed && event.key.code == Keyboard::Space) {
+                // Started below, once the previous recording is written
+                if (recorder.isWriting() && !waitingForRecorder)
+                    cout << "Still writing the previous recording" << endl;
+                waitingForRecorder = true;
+            } else if (event.type == Event::KeyReleased && event.key.code == Keyboard::Space) {
+                waitingForRecorder = false;
+                if (recorder.isRecording()) {
+                    cout << "Stopped recording." << endl;
+                    recorder.stop();
                 }
-                recording = false;
-            }
-            
-            if (recording) {
-                animated.push_back(prettyImage);
             }
             
             if (event.type == Event::KeyPressed) {
@@ -187,22 +303,38 @@ int main(int, char const**)
                     case Keyboard::Escape:
                         window.close();
                         break;
+                    case Keyboard::T:
+                        if (!tracePath.empty()) {
+                            if (sfe::Trace::writeChromeTrace(tracePath)) {
+                                cout << "Wrote trace to " << tracePath << endl;
+                            } else {
+                                cerr << "Could not write trace to " << tracePath << endl;
+                            }
+                        }
+                        break;
+                    case Keyboard::H:
+                        showHud = !showHud && hud.loadFont();
+                        profiler.setEnabled(showHud || metrics.isOpen());
+                        break;
                     case Keyboard::Return:
-                        if (movie.getStatus() == sfe::Status::Stopped || movie.getStatus() == sfe::Status::Paused) {
-                            movie.play();
+                        if (!movie) {
+                            break;
+                        }
+                        if (movie->getStatus() == sfe::Status::Stopped || movie->getStatus() == sfe::Status::Paused) {
+                            movie->play();
                         } else {
-                            movie.pause();
+                            movie->pause();
                         }
                         break;
                     case Keyboard::Down:
-                        oldMediaIndex = mediaIndex;
-                        mediaIndex = (mediaIndex + 1) % medias.size();
+                        oldMediaIndex = playlist.getIndex();
+                        playlist.next();
                         updateMedia = true;
                         break;
                     case Keyboard::Up:
-                        oldMediaIndex = mediaIndex;
-                        mediaIndex = (mediaIndex - 1) % medias.size();
-                        cout << oldMediaIndex << " TO " << mediaIndex << endl;
+                        oldMediaIndex = playlist.getIndex();
+                        playlist.previous();
+                        cout << oldMediaIndex << " TO " << playlist.getIndex() << endl;
                         updateMedia = true;
                         break;
                     default:
@@ -212,50 +344,77 @@ int main(int, char const**)
                 updateStateFromKeyboard(state, event.key.code);
             }
         }
+
+        // Held down, space starts recording as soon as the previous
+        // recording is written, without waiting for key repeats
+        if (waitingForRecorder && !recorder.isWriting()) {
+            cout << "Recording to " << recordOptions.path << endl;
+            recorder.start(createFrameSink(recordOptions), recordOptions.speed);
+            recordClock.restart();
+            waitingForRecorder = false;
+        }
         
-        Media& activeMedia = medias[mediaIndex];
+        const Media& activeMedia = playlist.getMedia();
+        bool newSource = false;
 
         if (updateMedia) {
             updateMedia = false;
 
             if (!firstUpdate) {
-                Media& oldMedia = medias[oldMediaIndex];
-                if (oldMedia.type == Media::WEBCAM) {
-                    if (webcam.isOpened()) {
-                      webcam.release();
+                const Media& oldMedia = playlist.getMedia(oldMediaIndex);
+                source = nullptr;
+                if (oldMedia.type == Media::MOVIE && movie) {
+                    if (movie->getStatus() != sfe::Status::Stopped) {
+                        movie->stop();
                     }
-                }
-                if (oldMedia.type == Media::MOVIE) {
-                    movie.stop();
+                    movie = nullptr;
+                    playlist.recycle(oldMediaIndex);
                 }
             } else {
                 firstUpdate = false;
             }
             
             if (activeMedia.type == Media::MOVIE) {
-              cout << "Loading movie " << activeMedia.filename << endl;
-            
-              movie.openFromFile(activeMedia.filename);
-              texture.create(movie.getSize().x, movie.getSize().y);
-              displaySprite.setTexture(texture, true);
-              displaySprite.setOrigin(movie.getSize().x/2.0f, movie.getSize().y/2.0f);
-              displaySprite.setPosition(window.getSize().x/2.0f, window.getSize().y/2.0f);
-              displaySprite.setRotation(movie.getVideoRotation());
+              // The playlist opens movies in the background, keep showing
+              // the previous frame until this one is ready
+              waitingForMovie = true;
             } else if (activeMedia.type == Media::WEBCAM) {
-                webcam.open(0);
-                
-                /* HACK */
-                const static int CV_CAP_PROP_FRAME_WIDTH    =3;
-                const static int CV_CAP_PROP_FRAME_HEIGHT   =4;
-
-                int width = webcam.get(CV_CAP_PROP_FRAME_WIDTH);
-                int height = webcam.get(CV_CAP_PROP_FRAME_HEIGHT);
+                source.reset(new WebcamSource(0));
+                newSource = true;
+            } else if (activeMedia.type == Media::IMAGE) {
+                source.reset(new ImageSequenceSource(vector<string>(1, activeMedia.filename)));
+                newSource = true;
+            } else if (activeMedia.type == Media::SYNTHETIC) {
+                SyntheticSource::Pattern pattern = SyntheticSource::Photo;
+                SyntheticSource::patternFromName(activeMedia.filename, pattern);
+                source.reset(new SyntheticSource(Vector2u(1280, 720), pattern));
+                newSource = true;
+            }
+        }
+        
+        if (waitingForMovie) {
+            movie = playlist.getMovie();
+            if (movie) {
+              waitingForMovie = false;
+              cout << "Showing movie " << activeMedia.filename << endl;
+              movie->setLoop(true);
+              source.reset(new MovieSource(movie));
+              newSource = true;
+            } else if (playlist.didFail()) {
+              waitingForMovie = false;
+            }
+        }
 
-                texture.create(width, height);
+        if (newSource) {
+            if (source->open()) {
+                Vector2u size = source->getSize();
+                texture.create(size.x, size.y);
                 displaySprite.setTexture(texture, true);
-                displaySprite.setOrigin(width/2.0f, height/2.0f);
+                displaySprite.setOrigin(size.x/2.0f, size.y/2.0f);
                 displaySprite.setPosition(window.getSize().x/2.0f, window.getSize().y/2.0f);
-                displaySprite.setRotation(0);
+                displaySprite.setRotation(source->getRotation());
+            } else {
+                source = nullptr;
             }
         }
         
@@ -264,29 +423,60 @@ int main(int, char const**)
 
         state.time = globalClock.getElapsedTime().asSeconds();
 
-        if (activeMedia.type == Media::MOVIE) {
-            if (movie.getStatus() == sfe::Status::Stopped) {
-                movie.play();
+        // The frame is sorted in place and shown, recorded and published
+        // from the source's own buffer
+        if (source && source->acquire(frame)) {
+            // Replays need a file to decode again, recording starts with the
+            // first movie and covers that movie only
+            if (!stateRecordingPath.empty() && activeMedia.type == Media::MOVIE) {
+                if (stateRecorder.open(stateRecordingPath, activeMedia.filename))
+                    cout << "Recording states of " << activeMedia.filename << " to " << stateRecordingPath << endl;
+                stateRecordingPath.clear();
+            } else if (stateRecorder.isOpen() && activeMedia.filename != stateRecorder.getMedia()) {
+                cout << "Stopped recording states after " << stateRecorder.getFrameCount() << " frames" << endl;
+                stateRecorder.close();
             }
-            movie.update();
-            prettyImage = movie.getCurrentImage().copyToImage();
-        } else if (activeMedia.type == Media::WEBCAM) {
-            webcam >> frameRGB;
-            if (!frameRGB.empty()) {
-                cv::cvtColor(frameRGB, frameRGBA, cv::COLOR_BGR2RGBA);
-                prettyImage.create(frameRGBA.cols, frameRGBA.rows, frameRGBA.ptr());
+
+            if (stateRecorder.isOpen()) {
+                srand(stateRecorder.getNextSeed());
+                stateRecorder.write(frame.timestamp, state);
             }
+
+            prettySort(reinterpret_cast<Uint32*>(frame.pixels), frame.size, state, profiler.getSortStats());
+            
+            if (recorder.isRecording()) {
+                recorder.addFrame(frame.pixels, frame.size, recordClock.getElapsedTime());
+            }
+
+            if (frameRing.isOpen()) {
+                if (!frameRing.publish(frame.pixels, frame.size, globalClock.getElapsedTime())) {
+                    cerr << "Frames are larger than --shm-size, stopped publishing them" << endl;
+                    frameRing.close();
+                }
+            }
+
+            {
+                sfeTraceZone("texture upload");
+                texture.update(frame.pixels);
+            }
+            source->release(frame);
         }
         
-        prettySort(prettyImage, state);
-        
-        texture.update(prettyImage);
-        
-        window.clear();
-        window.draw(displaySprite);
-        
+        profiler.endFrame(movie.get(), recorder);
+        metrics.write(profiler.getLastFrame());
+
+        {
+            sfeTraceZone("display");
+            window.clear();
+            window.draw(displaySprite);
+            if (showHud)
+                hud.draw(window, profiler.getLastFrame());
+            window.display();
+        }
+    }
 
-        window.display();
+    if (!tracePath.empty() && sfe::Trace::writeChromeTrace(tracePath)) {
+        cout << "Wrote trace to " << tracePath << endl;
     }
     
 //    edgeMain("/Users/kevin/Desktop/penguins.jpg");
@@ -9,6 +9,7 @@
 #ifndef pixelsort_platform_h
 #define pixelsort_platform_h
 
+#include <cstddef>
 #include <vector>
 #include <string>
 
@@ -21,6 +22,12 @@ vector<string> listDir(const string& dirName);
 vector<string> findMovies();
 string nextFilename();
 
+// Bytes of the process currently in physical memory, 0 if unknown
+size_t getResidentMemory();
+
+// Where to keep a file of this name that can be thrown away and made again
+string cachePath(const string& filename);
+
 typedef void (*watchFileCallback)();
 
 #ifdef __APPLE__
@@ -10,7 +10,9 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstdlib>
 #include <dirent.h>
+#include <mach/mach.h>
 
 using namespace std;
 
@@ -53,6 +55,21 @@ string nextFilename()
     //savePath += "/" filename;
 }
 
+size_t getResidentMemory()
+{
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+    return info.resident_size;
+}
+
+string cachePath(const string& filename)
+{
+    const char* home = getenv("HOME");
+    return string(home ? home : "/tmp") + "/Library/Caches/" + filename;
+}
+
 OSXWatcher::OSXWatcher(string filename, watchFileCallback callback_)
     : dirToWatch(filename)
     , callback(callback_)
@@ -34,18 +34,48 @@ extern "C"
 #include "VideoStream.hpp"
 #include "Log.hpp"
 #include "Utilities.hpp"
+#include "Trace.hpp"
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 
 namespace sfe
 {
     std::list<Demuxer::DemuxerInfo> Demuxer::g_availableDemuxers;
     std::list<Demuxer::DecoderInfo> Demuxer::g_availableDecoders;
     
-    static void loadFFmpeg()
+    static int lockManager(void** mutex, enum AVLockOp op)
     {
+        switch (op)
+        {
+            case AV_LOCK_CREATE:
+                *mutex = new sf::Mutex;
+                return 0;
+            case AV_LOCK_OBTAIN:
+                static_cast<sf::Mutex*>(*mutex)->lock();
+                return 0;
+            case AV_LOCK_RELEASE:
+                static_cast<sf::Mutex*>(*mutex)->unlock();
+                return 0;
+            case AV_LOCK_DESTROY:
+                delete static_cast<sf::Mutex*>(*mutex);
+                *mutex = nullptr;
+                return 0;
+        }
+        
+        return 1;
+    }
+    
+    void Demuxer::loadFFmpeg()
+    {
+        // Medias may be opened from loading threads, make sure FFmpeg
+        // is only initialized once and that codec opening is serialized
+        static sf::Mutex loadMutex;
+        sf::Lock l(loadMutex);
+        
         ONCE(av_register_all());
         ONCE(avcodec_register_all());
+        ONCE(av_lockmgr_register(lockManager));
         ONCE(Log::initialize());
     }
     
@@ -54,6 +84,8 @@ namespace sfe
         switch (type)
         {
             case AVMEDIA_TYPE_VIDEO:    return Video;
+            case AVMEDIA_TYPE_AUDIO:    return Audio;
+            case AVMEDIA_TYPE_SUBTITLE: return Subtitle;
             default:                    return Unknown;
         }
     }
@@ -103,16 +135,26 @@ namespace sfe
         return g_availableDecoders;
     }
     
+    Demuxer::PassthroughDelegate::~PassthroughDelegate()
+    {
+    }
+    
     Demuxer::Demuxer(const std::string& sourceFile, std::shared_ptr<Timer> timer,
-                     VideoStream::Delegate& videoDelegate) :
+                     VideoStream::Delegate& videoDelegate, InputMode inputMode) :
     m_formatCtx(nullptr),
+    m_input(nullptr),
     m_eofReached(false),
     m_streams(),
     m_ignoredStreams(),
+    m_passthroughDelegate(nullptr),
+    m_passthroughType(Unknown),
     m_synchronized(),
     m_timer(timer),
     m_connectedVideoStream(nullptr),
-    m_duration(sf::Time::Zero)
+    m_duration(sf::Time::Zero),
+    m_pendingDataForActiveStreams(),
+    m_looping(false),
+    m_loopInfos()
     {
         CHECK(sourceFile.size(), "Demuxer::Demuxer() - invalid argument: sourceFile");
         CHECK(timer, "Inconsistency error: null timer");
@@ -122,6 +164,23 @@ namespace sfe
         // Load all the decoders
         loadFFmpeg();
         
+        // Use our own I/O if asked to, the file name is then only used for probing the format
+        if (inputMode != DefaultInput)
+        {
+            try
+            {
+                m_input = std::make_shared<MediaInput>(sourceFile, inputMode);
+                m_formatCtx = avformat_alloc_context();
+                CHECK(m_formatCtx, "Demuxer::Demuxer() - out of memory");
+                m_formatCtx->pb = m_input->getContext();
+            }
+            catch (std::runtime_error& e)
+            {
+                sfeLogWarning(std::string(e.what()) + ", falling back to default input");
+                m_input = nullptr;
+            }
+        }
+        
         // Open the movie file
         err = avformat_open_input(&m_formatCtx, sourceFile.c_str(), nullptr, nullptr);
         CHECK0(err, "Demuxer::Demuxer() - error while opening media: " + sourceFile);
@@ -298,10 +357,14 @@ namespace sfe
             {
                 if (!distributePacket(pkt, stream))
                 {
-                    AVStream* ffstream = m_formatCtx->streams[pkt->stream_index];
-                    std::string streamName = std::string("'") + av_get_media_type_string(ffstream->codec->codec_type) + "/" + avcodec_get_name(ffstream->codec->codec_id);
+                    if (!passThrough(pkt))
+                    {
+                        AVStream* ffstream = m_formatCtx->streams[pkt->stream_index];
+                        std::string streamName = std::string("'") + av_get_media_type_string(ffstream->codec->codec_type) + "/" + avcodec_get_name(ffstream->codec->codec_id);
+                        
+                        sfeLogDebug(streamName + " packet dropped");
+                    }
                     
-                    sfeLogDebug(streamName + " packet dropped");
                     av_free_packet(pkt);
                     av_free(pkt);
                 }
@@ -330,8 +393,43 @@ namespace sfe
         return m_duration;
     }
     
+    void Demuxer::setLooping(bool loop)
+    {
+        sf::Lock l(m_synchronized);
+        m_looping = loop;
+    }
+    
+    bool Demuxer::isLooping() const
+    {
+        sf::Lock l(m_synchronized);
+        return m_looping;
+    }
+    
+    std::vector<const AVStream*> Demuxer::getIgnoredStreams(MediaType type) const
+    {
+        std::vector<const AVStream*> streams;
+        
+        for (const std::pair<const int, std::string>& pair : m_ignoredStreams)
+        {
+            const AVStream* ffstream = m_formatCtx->streams[pair.first];
+            
+            if (AVMediaTypeToMediaType(ffstream->codec->codec_type) == type)
+                streams.push_back(ffstream);
+        }
+        
+        return streams;
+    }
+    
+    void Demuxer::setPassthroughDelegate(MediaType type, PassthroughDelegate* delegate)
+    {
+        sf::Lock l(m_synchronized);
+        m_passthroughType = type;
+        m_passthroughDelegate = delegate;
+    }
+    
     AVPacket* Demuxer::readPacket()
     {
+        sfeTraceZone("demux");
         sf::Lock l(m_synchronized);
         
         AVPacket *pkt = nullptr;
@@ -343,16 +441,116 @@ namespace sfe
         
         err = av_read_frame(m_formatCtx, pkt);
         
+        if (err < 0 && m_looping && rewindForLoop())
+        {
+            av_init_packet(pkt);
+            err = av_read_frame(m_formatCtx, pkt);
+        }
+        
         if (err < 0)
         {
             av_free_packet(pkt);
             av_free(pkt);
             pkt = nullptr;
         }
+        else
+        {
+            // Also before looping is enabled, the first packets tell where the media starts
+            applyLoopOffset(pkt);
+        }
         
         return pkt;
     }
     
+    int Demuxer::seekToBeginning()
+    {
+        int64_t timestamp = 0;
+        
+        if (m_formatCtx->iformat->flags & AVFMT_SEEK_TO_PTS)
+        {
+            if (m_formatCtx->start_time != AV_NOPTS_VALUE)
+                timestamp += m_formatCtx->start_time;
+        }
+        
+        return avformat_seek_file(m_formatCtx, -1, INT64_MIN, timestamp, INT64_MAX, AVSEEK_FLAG_BACKWARD);
+    }
+    
+    int Demuxer::seekToKeyframe(sf::Time position)
+    {
+        if (position <= sf::Time::Zero)
+            return seekToBeginning();
+        
+        int64_t timestamp = position.asMicroseconds() * AV_TIME_BASE / 1000000;
+        
+        if (m_formatCtx->start_time != AV_NOPTS_VALUE)
+            timestamp += m_formatCtx->start_time;
+        
+        return avformat_seek_file(m_formatCtx, -1, INT64_MIN, timestamp, timestamp + AV_TIME_BASE / 1000 - 1, 0);
+    }
+    
+    bool Demuxer::rewindForLoop()
+    {
+        if (m_loopInfos.empty())
+            return false;
+        
+        int err = seekToBeginning();
+        if (err < 0)
+        {
+            sfeLogError("Could not rewind the media for looping: " + s(err));
+            return false;
+        }
+        
+        // Timestamps of the next loop start right after the last frame of this one
+        for (std::pair<const int, LoopInfo>& pair : m_loopInfos)
+        {
+            LoopInfo& info = pair.second;
+            info.offset += info.endTimestamp - info.firstTimestamp;
+        }
+        
+        sfeLogDebug("Media rewound for looping");
+        return true;
+    }
+    
+    void Demuxer::applyLoopOffset(AVPacket* packet)
+    {
+        int64_t timestamp = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        
+        if (timestamp == AV_NOPTS_VALUE)
+            return;
+        
+        std::map<int, LoopInfo>::iterator it = m_loopInfos.find(packet->stream_index);
+        if (it == m_loopInfos.end())
+        {
+            LoopInfo info = {timestamp, timestamp, 0};
+            it = m_loopInfos.insert(std::make_pair(packet->stream_index, info)).first;
+        }
+        
+        LoopInfo& info = it->second;
+        int64_t duration = packet->duration;
+        
+        if (duration <= 0)
+        {
+            AVStream* ffstream = m_formatCtx->streams[packet->stream_index];
+            AVRational frameRate = av_guess_frame_rate(m_formatCtx, ffstream, nullptr);
+            
+            if (frameRate.num && frameRate.den)
+                duration = av_rescale_q(1, av_inv_q(frameRate), ffstream->time_base);
+        }
+        
+        // Only the first loop tells where the media starts and ends
+        if (info.offset == 0)
+        {
+            info.firstTimestamp = std::min(info.firstTimestamp, timestamp);
+            info.endTimestamp = std::max(info.endTimestamp, timestamp + duration);
+        }
+        
+        if (packet->pts != AV_NOPTS_VALUE)
+            packet->pts += info.offset;
+        
+        if (packet->dts != AV_NOPTS_VALUE)
+            packet->dts += info.offset;
+    }
+    
     void Demuxer::flushBuffers()
     {
         sf::Lock l(m_synchronized);
@@ -418,6 +616,38 @@ namespace sfe
         return result;
     }
     
+    bool Demuxer::passThrough(const AVPacket* packet)
+    {
+        if (!m_passthroughDelegate || !m_ignoredStreams.count(packet->stream_index))
+            return false;
+        
+        AVStream* ffstream = m_formatCtx->streams[packet->stream_index];
+        if (AVMediaTypeToMediaType(ffstream->codec->codec_type) != m_passthroughType)
+            return false;
+        
+        // Decoded frames are timestamped from the start of the video stream,
+        // shift the packet by the same amount to keep them in sync
+        int64_t shift = 0;
+        for (const std::pair<const int, std::shared_ptr<Stream> >& pair : m_streams)
+        {
+            const AVStream* videoStream = m_formatCtx->streams[pair.first];
+            
+            if (pair.second == m_connectedVideoStream && videoStream->start_time != AV_NOPTS_VALUE)
+                shift = av_rescale_q(videoStream->start_time, videoStream->time_base, ffstream->time_base);
+        }
+        
+        AVPacket shifted = *packet;
+        
+        if (shifted.pts != AV_NOPTS_VALUE)
+            shifted.pts -= shift;
+        
+        if (shifted.dts != AV_NOPTS_VALUE)
+            shifted.dts -= shift;
+        
+        m_passthroughDelegate->didReadPacket(*ffstream, shifted);
+        return true;
+    }
+    
     void Demuxer::extractDurationFromStream(const AVStream* stream)
     {
         if (m_duration != sf::Time::Zero)
@@ -449,29 +679,18 @@ namespace sfe
         resetEndOfFileStatus();
         flushBuffers();
         
-        if (m_formatCtx->iformat->flags & AVFMT_SEEK_TO_PTS)
-        {
-            int64_t timestamp = 0;
-            
-            if (m_formatCtx->start_time != AV_NOPTS_VALUE)
-                timestamp += m_formatCtx->start_time;
-            
-            int err = avformat_seek_file(m_formatCtx, -1, INT64_MIN, timestamp, INT64_MAX, AVSEEK_FLAG_BACKWARD);
-            sfeLogDebug("Seek by PTS at timestamp=" + s(timestamp) + " returned " + s(err));
-            
-            if (err < 0)
-                sfeLogError("Error while seeking at time " + s(position.asMilliseconds()) + "ms");
-        }
-        else
+        // Positions are relative to the first loop, whose bounds stay known
         {
-            int err = avformat_seek_file(m_formatCtx, -1, INT64_MIN, 0, INT64_MAX, AVSEEK_FLAG_BACKWARD);
-            //            sfeLogDebug("Seek by PTS at timestamp=" + s(timestamp) + " returned " + s(err));
-            
-            //            int err = av_seek_frame(m_formatCtx, m_streamID, -999999, AVSEEK_FLAG_BACKWARD);
-            sfeLogDebug("Seek by DTS at timestamp " + s(-9999) + " returned " + s(err));
+            sf::Lock l(m_synchronized);
             
-            if (err < 0)
-                sfeLogError("Error while seeking at time " + s(position.asMilliseconds()) + "ms");
+            for (std::pair<const int, LoopInfo>& pair : m_loopInfos)
+                pair.second.offset = 0;
         }
+        
+        int err = seekToKeyframe(position);
+        sfeLogDebug("Seek to " + s(position.asMilliseconds()) + "ms returned " + s(err));
+        
+        if (err < 0)
+            sfeLogError("Error while seeking at time " + s(position.asMilliseconds()) + "ms");
     }
 }
@@ -29,10 +29,12 @@
 #include "Stream.hpp"
 #include "VideoStream.hpp"
 #include "Timer.hpp"
+#include "MediaInput.hpp"
 #include <map>
 #include <string>
 #include <set>
 #include <list>
+#include <vector>
 #include <utility>
 #include <memory>
 
@@ -62,6 +64,27 @@ namespace sfe
             MediaType type;
         };
         
+        /** Receives the packets of the streams that aren't decoded, so that they can
+         * be copied as they are to another file (eg. the soundtrack of an offline render)
+         */
+        class PassthroughDelegate
+        {
+        public:
+            /** Default destructor
+             */
+            virtual ~PassthroughDelegate();
+            
+            /** Called for every packet read from a passed through stream, in file order
+             *
+             * Timestamps are in the time base of @a stream and relative to the start of
+             * the selected video stream, like the timestamps of the decoded frames
+             *
+             * @param stream the stream the packet belongs to
+             * @param packet the packet, which remains owned by the demuxer
+             */
+            virtual void didReadPacket(const AVStream& stream, const AVPacket& packet) = 0;
+        };
+        
         /** Return a list containing the names of all the demuxers (ie. container parsers) included
          * in this sfeMovie build
          */
@@ -72,6 +95,14 @@ namespace sfe
          */
         static const std::list<DecoderInfo>& getAvailableDecoders();
         
+        /** Initialize FFmpeg, once for the whole process
+         *
+         * Demuxers do it when they are created. Code that uses FFmpeg on its own, like
+         * an encoder, must call it first so that it doesn't race with a media being
+         * opened on another thread
+         */
+        static void loadFFmpeg();
+        
         /** Default constructor
          *
          * Open a media file and find its streams
@@ -79,8 +110,11 @@ namespace sfe
          * @param sourceFile the path of the media to open and play
          * @param timer the timer with which the media streams will be synchronized
          * @param videoDelegate the delegate that will handle the images produced by the VideoStreams
+         * @param inputMode how the media file should be read; if the custom input cannot be used
+         * for this file, FFmpeg's default I/O is used instead
          */
-        Demuxer(const std::string& sourceFile, std::shared_ptr<Timer> timer, VideoStream::Delegate& videoDelegate);
+        Demuxer(const std::string& sourceFile, std::shared_ptr<Timer> timer, VideoStream::Delegate& videoDelegate,
+                InputMode inputMode = DefaultInput);
         
         /** Default destructor
          */
@@ -151,7 +185,81 @@ namespace sfe
          */
         sf::Time getDuration() const;
         
+        /** Enable or disable looping
+         *
+         * When looping, reaching the end of the file rewinds the demuxer in place and
+         * the packets of the next loop are timestamped after the ones of the previous loop.
+         * The start of the media is thus read and queued before the last frame is shown,
+         * and playback goes on without being stopped, flushed or restarted.
+         *
+         * @param loop true to play the media in loop, false otherwise
+         */
+        void setLooping(bool loop);
+        
+        /** Tell whether the demuxer loops over the media
+         *
+         * @return true if looping, false otherwise
+         */
+        bool isLooping() const;
+        
+        /** Return the streams of the given type that are not decoded
+         *
+         * @param type the type of the streams to return, eg. Audio
+         * @return the streams, owned by the demuxer
+         */
+        std::vector<const AVStream*> getIgnoredStreams(MediaType type) const;
+        
+        /** Send the packets of the ignored streams of the given type to a delegate
+         * instead of dropping them
+         *
+         * Packets are only read when a decoded stream needs data, so they arrive
+         * along with the video packets around them
+         *
+         * @param type the type of the streams to pass through, eg. Audio
+         * @param delegate the receiver of the packets, or nullptr to drop them again
+         */
+        void setPassthroughDelegate(MediaType type, PassthroughDelegate* delegate);
+        
     private:
+        /** Per-stream timestamps needed to chain loops
+         *
+         * All values are expressed in the stream time base
+         */
+        struct LoopInfo
+        {
+            int64_t firstTimestamp;
+            int64_t endTimestamp;
+            int64_t offset;
+        };
+        
+        /** Seek the media back to its beginning
+         *
+         * @return the FFmpeg seeking error code
+         */
+        int seekToBeginning();
+        
+        /** Seek the media to the keyframe closest to @a position
+         *
+         * Positions are given with a millisecond precision, so a keyframe
+         * within the millisecond following @a position is preferred
+         *
+         * @param position the wished position, relative to the beginning of the media
+         * @return the FFmpeg seeking error code
+         */
+        int seekToKeyframe(sf::Time position);
+        
+        /** Rewind the media and shift the timestamps of the next loop
+         *
+         * @return true if the media could be rewound, false otherwise
+         */
+        bool rewindForLoop();
+        
+        /** Record the timestamps of @a packet and shift them by the current loop offset
+         *
+         * @param packet the freshly read packet
+         */
+        void applyLoopOffset(AVPacket* packet);
+        
         /** Read a encoded packet from the media file
          *
          * You're responsible for freeing the returned packet
@@ -189,6 +297,13 @@ namespace sfe
          */
         bool distributePacket(AVPacket* packet, Stream& stream);
         
+        /** Give the packet of an ignored stream to the passthrough delegate, if there's one
+         *
+         * @param packet the packet to pass through, still owned by the caller
+         * @return true if the packet was passed through, false otherwise
+         */
+        bool passThrough(const AVPacket* packet);
+        
         /** Try to extract the media duration from the given stream
          */
         void extractDurationFromStream(const AVStream* stream);
@@ -201,14 +316,19 @@ namespace sfe
         void willSeek(const Timer& timer, sf::Time position);
         
         AVFormatContext* m_formatCtx;
+        std::shared_ptr<MediaInput> m_input;
         bool m_eofReached;
         std::map<int, std::shared_ptr<Stream> > m_streams;
         std::map<int, std::string> m_ignoredStreams;
-        sf::Mutex m_synchronized;
+        PassthroughDelegate* m_passthroughDelegate;
+        MediaType m_passthroughType;
+        mutable sf::Mutex m_synchronized;
         std::shared_ptr<Timer> m_timer;
         std::shared_ptr<Stream> m_connectedVideoStream;
         sf::Time m_duration;
         std::list <AVPacket*> m_pendingDataForActiveStreams;
+        bool m_looping;
+        std::map<int, LoopInfo> m_loopInfos;
         
         static std::list<DemuxerInfo> g_availableDemuxers;
         static std::list<DecoderInfo> g_availableDecoders;
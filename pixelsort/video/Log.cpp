@@ -24,8 +24,12 @@
 
 #include "Log.hpp"
 #include "Macros.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <SFML/System.hpp>
+#include <mutex>
+#include <thread>
 extern "C"
 {
 #include <libavutil/avutil.h>
@@ -35,8 +39,166 @@ namespace sfe
 {
     namespace Log
     {
-        static int g_logLevel = ErrorLogLevel;
-        static sf::Mutex g_synchronized;
+        std::atomic<int> g_logLevel(ErrorLogLevel);
+        
+        namespace
+        {
+            /** Bounded multiple producers, single consumer queue of formatted messages
+             *
+             * Every slot carries a sequence number telling whether it is free for the
+             * producer at that position or filled for the consumer, so that producers
+             * only race on the tail with a compare-and-swap and never wait for each other.
+             */
+            class MessageQueue
+            {
+            public:
+                static const std::size_t Capacity = 1024;
+                
+                MessageQueue() :
+                m_head(0),
+                m_tail(0),
+                m_dropped(0)
+                {
+                    for (std::size_t i = 0; i < Capacity; ++i)
+                        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+                
+                /** Queue a message, or drop it if the queue is full
+                 */
+                bool push(std::string& text)
+                {
+                    std::size_t position = m_tail.load(std::memory_order_relaxed);
+                    Slot* slot;
+                    
+                    for (;;)
+                    {
+                        slot = &m_slots[position % Capacity];
+                        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                        
+                        if (difference == 0)
+                        {
+                            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                                break;
+                        }
+                        else if (difference < 0)
+                        {
+                            m_dropped.fetch_add(1, std::memory_order_relaxed);
+                            return false;
+                        }
+                        else
+                        {
+                            position = m_tail.load(std::memory_order_relaxed);
+                        }
+                    }
+                    
+                    slot->text.swap(text);
+                    slot->sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+                
+                /** Take the oldest message, only called by the log thread
+                 */
+                bool pop(std::string& text)
+                {
+                    std::size_t position = m_head.load(std::memory_order_relaxed);
+                    Slot& slot = m_slots[position % Capacity];
+                    
+                    if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+                        return false;
+                    
+                    text.swap(slot.text);
+                    slot.text.clear();
+                    slot.sequence.store(position + Capacity, std::memory_order_release);
+                    m_head.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+                
+                /** Tell whether every message queued so far was taken
+                 */
+                bool isDrained() const
+                {
+                    return m_head.load(std::memory_order_acquire) >= m_tail.load(std::memory_order_acquire);
+                }
+                
+                std::size_t takeDroppedCount()
+                {
+                    return m_dropped.exchange(0, std::memory_order_relaxed);
+                }
+                
+            private:
+                struct Slot
+                {
+                    std::atomic<std::size_t> sequence;
+                    std::string text;
+                };
+                
+                Slot m_slots[Capacity];
+                std::atomic<std::size_t> m_head;
+                std::atomic<std::size_t> m_tail;
+                std::atomic<std::size_t> m_dropped;
+            };
+            
+            // Never destroyed: objects destroyed at exit may still log. Once the log thread
+            // is stopped at exit, messages are written right away instead.
+            MessageQueue& g_queue = *new MessageQueue;
+            std::atomic<bool> g_running(false);
+            std::atomic<bool> g_stopped(false);
+            std::once_flag g_threadStarted;
+            std::thread* g_thread = nullptr;
+            
+            // How long the log thread sleeps when there is nothing to write
+            const std::chrono::milliseconds IdleDelay(5);
+            
+            void writeQueuedMessages()
+            {
+                std::string text;
+                
+                while (g_queue.pop(text))
+                    std::cerr << text << std::endl;
+                
+                std::size_t dropped = g_queue.takeDroppedCount();
+                if (dropped > 0)
+                    std::cerr << "Warning: " << dropped << " log messages were dropped" << std::endl;
+            }
+            
+            void logLoop()
+            {
+                while (g_running.load(std::memory_order_acquire))
+                {
+                    writeQueuedMessages();
+                    std::this_thread::sleep_for(IdleDelay);
+                }
+                
+                writeQueuedMessages();
+            }
+            
+            void stopThread()
+            {
+                g_stopped.store(true, std::memory_order_release);
+                g_running.store(false, std::memory_order_release);
+                
+                if (g_thread)
+                    g_thread->join();
+            }
+            
+            void startThread()
+            {
+                g_running.store(true, std::memory_order_release);
+                g_thread = new std::thread(logLoop);
+                std::atexit(stopThread);
+            }
+            
+            const char* prefix(LogLevel level)
+            {
+                switch (level)
+                {
+                    case DebugLogLevel:     return "Debug: ";
+                    case WarningLogLevel:   return "Warning: ";
+                    default:                return "Error: ";
+                }
+            }
+        }
         
         void initialize()
         {
@@ -49,8 +211,7 @@ namespace sfe
         
         void setLogLevel(LogLevel level)
         {
-            sf::Lock l(g_synchronized);
-            g_logLevel = level;
+            g_logLevel.store(level, std::memory_order_relaxed);
             
             switch (level)
             {
@@ -62,44 +223,35 @@ namespace sfe
             }
         }
         
-        static std::string filename(const std::string& filepath)
+        static const char* filename(const char* filepath)
         {
-            size_t pos = filepath.find_last_of("/");
+            const char* slash = std::strrchr(filepath, '/');
             
-            if (pos != std::string::npos && pos+1 != filepath.size())
-                return filepath.substr(pos+1);
+            if (slash && slash[1] != '\0')
+                return slash + 1;
             else
                 return filepath;
         }
         
-        void debug(const std::string& file, const std::string& message)
+        void log(LogLevel level, const char* file, int line, const char* function, const std::string& message)
         {
-            sf::Lock l(g_synchronized);
+            std::string text = std::string(prefix(level)) + filename(file) + ":" + std::to_string(line) + ": "
+                + function + "() - " + message;
             
-            if (g_logLevel >= DebugLogLevel)
+            if (g_stopped.load(std::memory_order_acquire))
             {
-                std::cerr << "Debug: " << filename(file) << message << std::endl;
+                std::cerr << text << std::endl;
+                return;
             }
-        }
-        
-        void warning(const std::string& file, const std::string& message)
-        {
-            sf::Lock l(g_synchronized);
             
-            if (g_logLevel >= WarningLogLevel)
-            {
-                std::cerr << "Warning: " << filename(file) << message << std::endl;
-            }
+            std::call_once(g_threadStarted, startThread);
+            g_queue.push(text);
         }
         
-        void error(const std::string& file, const std::string& message)
+        void flush()
         {
-            sf::Lock l(g_synchronized);
-            
-            if (g_logLevel >= ErrorLogLevel)
-            {
-                std::cerr << "Error: " << filename(file) << message << std::endl;
-            }
+            while (g_running.load(std::memory_order_acquire) && !g_queue.isDrained())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
 }
@@ -25,6 +25,7 @@
 #ifndef SFEMOVIE_LOG_HPP
 #define SFEMOVIE_LOG_HPP
 
+#include <atomic>
 #include <string>
 #include <sstream>
 
@@ -34,9 +35,17 @@
 #define FUNC_NAME __func__
 #endif
 
-#define sfeLogDebug(message) sfe::Log::debug(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message)
-#define sfeLogWarning(message) sfe::Log::warning(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message)
-#define sfeLogError(message) sfe::Log::error(__FILE__, std::string(":") + sfe::s(__LINE__) + ": " + std::string(FUNC_NAME) + "()" + " - " + message)
+/** The level is checked before the message is built, a disabled message costs an atomic load
+ */
+#define sfeLogDebug(message) sfeLogAtLevel(sfe::Log::DebugLogLevel, message)
+#define sfeLogWarning(message) sfeLogAtLevel(sfe::Log::WarningLogLevel, message)
+#define sfeLogError(message) sfeLogAtLevel(sfe::Log::ErrorLogLevel, message)
+
+#define sfeLogAtLevel(level, message) \
+do { \
+    if (sfe::Log::isEnabled(level)) \
+        sfe::Log::log(level, __FILE__, __LINE__, FUNC_NAME, std::string() + message); \
+} while (false)
 
 namespace sfe
 {
@@ -60,23 +69,36 @@ namespace sfe
          */
         void setLogLevel(LogLevel level);
         
-        /** Log a debug @a message if the currently set mask allows it
+        // Set by setLogLevel(), inline so that filtered out messages cost no call
+        extern std::atomic<int> g_logLevel;
+        
+        /** Tell whether messages of the given @a level are logged
          *
-         * @param message the debug message to log
+         * @param level the kind of message
+         * @return true if the currently set level allows it
          */
-        void debug(const std::string& file, const std::string& message);
+        inline bool isEnabled(LogLevel level)
+        {
+            return g_logLevel.load(std::memory_order_relaxed) >= level;
+        }
         
-        /** Log a warning @a message if the currently set mask allows it
+        /** Queue a @a message for the log thread, which writes it to the standard error output
+         *
+         * Logging never waits: messages go through a lock-free ring buffer, and when the log
+         * thread falls too far behind they are dropped, and counted. The log level is not
+         * checked, the macros above do it.
          *
-         * @param message the warning message to log
+         * @param level the kind of message
+         * @param file the source file that logs the message
+         * @param line the line of the source file
+         * @param function the function that logs the message
+         * @param message the message to log
          */
-        void warning(const std::string& file, const std::string& message);
+        void log(LogLevel level, const char* file, int line, const char* function, const std::string& message);
         
-        /** Log an error @a message if the currently set mask allows it
-         *
-         * @param message the error message to log
+        /** Wait until the messages logged so far are written
          */
-        void error(const std::string& file, const std::string& message);
+        void flush();
     }
     
     /** Stringify any type of object supported by ostringstream
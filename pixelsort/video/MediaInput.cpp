@@ -0,0 +1,221 @@
+/*
+ *  MediaInput.cpp
+ *  sfeMovie project
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavutil/mem.h>
+}
+
+#include "MediaInput.hpp"
+#include "Macros.hpp"
+#include "Log.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace sfe
+{
+    // Size of the buffer given to FFmpeg when serving reads from a mapping
+    static const int MappedBufferSize = 256 * 1024;
+    
+    // Size of the buffer used for reading files with LargeBufferInput
+    static const int LargeBufferSize = 4 * 1024 * 1024;
+    
+    // How far ahead of the read position the mapping is prefetched
+    static const int64_t ReadaheadWindow = 16 * 1024 * 1024;
+    
+    MediaInput::MediaInput(const std::string& sourceFile, InputMode mode) :
+    m_mode(mode),
+    m_fd(-1),
+    m_size(0),
+    m_position(0),
+    m_mapping(nullptr),
+    m_advisedEnd(0),
+    m_ioCtx(nullptr),
+    m_readCalls(0),
+    m_systemReads(0)
+    {
+        CHECK(mode == MemoryMappedInput || mode == LargeBufferInput, "MediaInput::MediaInput() - invalid input mode");
+        
+        m_fd = ::open(sourceFile.c_str(), O_RDONLY);
+        CHECK(m_fd >= 0, "MediaInput::MediaInput() - cannot open " + sourceFile);
+        
+        struct stat info;
+        if (fstat(m_fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+        {
+            ::close(m_fd);
+            CHECK(false, "MediaInput::MediaInput() - not a regular file: " + sourceFile);
+        }
+        
+        m_size = info.st_size;
+        
+        if (mode == MemoryMappedInput)
+        {
+            void* mapping = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (mapping == MAP_FAILED)
+            {
+                ::close(m_fd);
+                CHECK(false, "MediaInput::MediaInput() - cannot map " + sourceFile);
+            }
+            
+            m_mapping = static_cast<uint8_t*>(mapping);
+            madvise(m_mapping, static_cast<size_t>(m_size), MADV_SEQUENTIAL);
+            adviseReadahead();
+            
+            // Reads are served from the mapping, the descriptor is not needed anymore
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        else
+        {
+#if defined(__APPLE__)
+            fcntl(m_fd, F_RDAHEAD, 1);
+#elif defined(POSIX_FADV_SEQUENTIAL)
+            posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        }
+        
+        int bufferSize = (mode == MemoryMappedInput) ? MappedBufferSize : LargeBufferSize;
+        uint8_t* buffer = static_cast<uint8_t*>(av_malloc(bufferSize));
+        
+        if (buffer)
+            m_ioCtx = avio_alloc_context(buffer, bufferSize, 0, this, &MediaInput::read, nullptr, &MediaInput::seek);
+        
+        if (!m_ioCtx)
+        {
+            av_free(buffer);
+            
+            if (m_mapping)
+                munmap(m_mapping, static_cast<size_t>(m_size));
+            
+            if (m_fd >= 0)
+                ::close(m_fd);
+            
+            CHECK(false, "MediaInput::MediaInput() - out of memory");
+        }
+    }
+    
+    MediaInput::~MediaInput()
+    {
+        sfeLogDebug(std::string(m_mode == MemoryMappedInput ? "Memory mapped" : "Buffered") + " input served "
+                    + s(m_readCalls) + " reads with " + s(m_systemReads) + " read() syscalls");
+        
+        if (m_ioCtx)
+        {
+            // FFmpeg may have reallocated the buffer, free the current one
+            av_freep(&m_ioCtx->buffer);
+            av_free(m_ioCtx);
+        }
+        
+        if (m_mapping)
+            munmap(m_mapping, static_cast<size_t>(m_size));
+        
+        if (m_fd >= 0)
+            ::close(m_fd);
+    }
+    
+    AVIOContext* MediaInput::getContext() const
+    {
+        return m_ioCtx;
+    }
+    
+    int MediaInput::read(void* opaque, uint8_t* buffer, int bufferSize)
+    {
+        MediaInput* self = static_cast<MediaInput*>(opaque);
+        self->m_readCalls++;
+        
+        if (self->m_position >= self->m_size)
+            return AVERROR_EOF;
+        
+        if (self->m_mapping)
+        {
+            int length = static_cast<int>(std::min<int64_t>(bufferSize, self->m_size - self->m_position));
+            memcpy(buffer, self->m_mapping + self->m_position, length);
+            self->m_position += length;
+            self->adviseReadahead();
+            return length;
+        }
+        
+        ssize_t length = 0;
+        do
+        {
+            self->m_systemReads++;
+            length = ::read(self->m_fd, buffer, bufferSize);
+        }
+        while (length < 0 && errno == EINTR);
+        
+        if (length < 0)
+            return AVERROR(errno);
+        
+        if (length == 0)
+            return AVERROR_EOF;
+        
+        self->m_position += length;
+        return static_cast<int>(length);
+    }
+    
+    int64_t MediaInput::seek(void* opaque, int64_t offset, int whence)
+    {
+        MediaInput* self = static_cast<MediaInput*>(opaque);
+        int64_t position = 0;
+        
+        switch (whence & ~AVSEEK_FORCE)
+        {
+            case AVSEEK_SIZE:   return self->m_size;
+            case SEEK_SET:      position = offset; break;
+            case SEEK_CUR:      position = self->m_position + offset; break;
+            case SEEK_END:      position = self->m_size + offset; break;
+            default:            return AVERROR(EINVAL);
+        }
+        
+        if (position < 0)
+            return AVERROR(EINVAL);
+        
+        if (!self->m_mapping && lseek(self->m_fd, position, SEEK_SET) < 0)
+            return AVERROR(errno);
+        
+        self->m_position = position;
+        self->m_advisedEnd = position;
+        self->adviseReadahead();
+        return position;
+    }
+    
+    void MediaInput::adviseReadahead()
+    {
+        if (!m_mapping || m_advisedEnd >= m_size)
+            return;
+        
+        // Only issue a new hint once half of the previous window has been consumed
+        if (m_advisedEnd - m_position > ReadaheadWindow / 2)
+            return;
+        
+        static const int64_t pageSize = sysconf(_SC_PAGESIZE);
+        int64_t start = (m_position / pageSize) * pageSize;
+        int64_t end = std::min(m_size, m_position + ReadaheadWindow);
+        
+        madvise(m_mapping + start, static_cast<size_t>(end - start), MADV_WILLNEED);
+        m_advisedEnd = end;
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ *  MediaInput.hpp
+ *  sfeMovie project
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_MEDIAINPUT_HPP
+#define SFEMOVIE_MEDIAINPUT_HPP
+
+#include "Movie.hpp"
+#include <string>
+#include <stdint.h>
+
+extern "C"
+{
+#include <libavformat/avio.h>
+}
+
+namespace sfe
+{
+    /** Custom I/O for reading local media files
+     *
+     * FFmpeg's default file protocol reads through a small buffer, which means one read()
+     * syscall and one copy every few KB. This class provides an AVIOContext that either
+     * serves reads from a memory mapping of the whole file, or reads the file through
+     * a large buffer, and gives the kernel sequential readahead hints in both cases.
+     */
+    class MediaInput
+    {
+    public:
+        /** Open the given file for reading with the given @a mode
+         *
+         * @param sourceFile the path of the media to open
+         * @param mode either MemoryMappedInput or LargeBufferInput
+         */
+        MediaInput(const std::string& sourceFile, InputMode mode);
+        
+        /** Default destructor
+         *
+         * The AVFormatContext using this input must have been closed before
+         */
+        ~MediaInput();
+        
+        /** Return the I/O context to use as AVFormatContext::pb
+         *
+         * @return the I/O context
+         */
+        AVIOContext* getContext() const;
+        
+    private:
+        static int read(void* opaque, uint8_t* buffer, int bufferSize);
+        static int64_t seek(void* opaque, int64_t offset, int whence);
+        
+        /** Ask the kernel to prefetch the part of the mapping that follows the read position
+         */
+        void adviseReadahead();
+        
+        InputMode m_mode;
+        int m_fd;
+        int64_t m_size;
+        int64_t m_position;
+        uint8_t* m_mapping;
+        int64_t m_advisedEnd;
+        AVIOContext* m_ioCtx;
+        
+        // Statistics used for comparing the I/O modes
+        uint64_t m_readCalls;
+        uint64_t m_systemReads;
+    };
+}
+
+#endif
@@ -46,9 +46,9 @@ namespace sfe
     }
     
     
-    bool Movie::openFromFile(const std::string& filename)
+    bool Movie::openFromFile(const std::string& filename, InputMode inputMode)
     {
-        return m_impl->openFromFile(filename);
+        return m_impl->openFromFile(filename, inputMode);
     }
     
     const Streams& Movie::getStreams(MediaType type) const
@@ -85,6 +85,54 @@ namespace sfe
     }
     
     
+    bool Movie::preload()
+    {
+        return m_impl->preload();
+    }
+    
+    
+    bool Movie::nextFrame(sf::Uint8* pixels, sf::Time* timestamp)
+    {
+        return m_impl->nextFrame(pixels, timestamp);
+    }
+    
+    
+    bool Movie::frameAt(sf::Uint64 index, sf::Uint8* pixels, sf::Time* timestamp)
+    {
+        return m_impl->frameAt(index, pixels, timestamp);
+    }
+    
+    
+    void Movie::setLoop(bool loop)
+    {
+        m_impl->setLoop(loop);
+    }
+    
+    
+    bool Movie::getLoop() const
+    {
+        return m_impl->getLoop();
+    }
+    
+    
+    void Movie::setClockMode(ClockMode mode)
+    {
+        m_impl->setClockMode(mode);
+    }
+    
+    
+    ClockMode Movie::getClockMode() const
+    {
+        return m_impl->getClockMode();
+    }
+    
+    
+    void Movie::setClockTime(sf::Time time)
+    {
+        m_impl->setClockTime(time);
+    }
+    
+    
     sf::Time Movie::getDuration() const
     {
         return m_impl->getDuration();
@@ -132,6 +180,17 @@ namespace sfe
         return m_impl->getCurrentImage();
     }
     
+    
+    bool Movie::copyCurrentFrame(sf::Uint8* pixels, sf::Time* timestamp) const
+    {
+        return m_impl->copyCurrentFrame(pixels, timestamp);
+    }
+    
+    PlaybackStatistics Movie::getPlaybackStatistics() const
+    {
+        return m_impl->getPlaybackStatistics();
+    }
+    
     void Movie::draw(sf::RenderTarget& target, sf::RenderStates states) const
     {
         states.transform *= getTransform();
@@ -53,6 +53,24 @@ namespace sfe
         Unknown
     };
     
+    /** Constants giving the way media files are read from the disk
+     */
+    enum InputMode
+    {
+        DefaultInput,      //!< Let FFmpeg open and read the file with its own small buffered I/O
+        MemoryMappedInput, //!< Map the file in memory and serve reads from the mapping (local files only)
+        LargeBufferInput   //!< Read the file through a large aligned buffer with readahead hints (local files only)
+    };
+    
+    /** Constants giving the source of time that drives the playback
+     */
+    enum ClockMode
+    {
+        RealTimeClock,  //!< Playback follows the wall clock
+        FrameStepClock, //!< Every call to update() moves the playback to the next video frame, however long it took
+        ExternalClock   //!< Playback only moves when Movie::setClockTime() is called
+    };
+    
     /** Structure that allows both knowing metadata about each stream, and identifying streams
      * for selection through Movie::selectStream()
      */
@@ -72,6 +90,15 @@ namespace sfe
     
     typedef std::vector<StreamDescriptor> Streams;
     
+    /** Structure giving where the decoding of a movie stands, for performance overlays
+     */
+    struct SFE_API PlaybackStatistics
+    {
+        std::size_t queuedVideoPackets; //!< Encoded video packets read from the file but not decoded yet
+        sf::Int64 decodedFrames;        //!< Video frames decoded since the movie was loaded or last rewound
+        sf::Time synchronizationGap;    //!< Time of the current frame minus the playing offset, negative when decoding is late
+    };
+    
     class MovieImpl;
     /** Main class of the sfeMovie API. It is used to open media files, provide playback and basic controls
      */
@@ -88,9 +115,10 @@ namespace sfe
          * video or audio stream.
          *
          * @param filename the path to the media file
+         * @param inputMode how the file should be read, see InputMode
          * @return true on success, false otherwise
          */
-        bool openFromFile(const std::string& filename);
+        bool openFromFile(const std::string& filename, InputMode inputMode = DefaultInput);
         
         /** @brief Return a description of all the streams of the given type contained in the opened media
          *
@@ -140,6 +168,91 @@ namespace sfe
          */
         void update();
         
+        /** @brief Decode the first image of a stopped movie ahead of play()
+         *
+         * This lets a movie be opened and prepared from a loading thread so that
+         * the first call to play() doesn't have to wait for the decoder.
+         *
+         * @return true if an image could be decoded, false otherwise
+         */
+        bool preload();
+        
+        /** @brief Decodes the video frame that follows the last one returned by nextFrame() or frameAt()
+         *
+         * Unlike update(), this ignores the playback clock: every call decodes exactly one frame, so
+         * that offline processing sees each frame once, with no frame dropped or repeated. The first
+         * call after opening or stopping the movie returns the first frame. getCurrentImage() is
+         * updated as well.
+         *
+         * @warning This method can only be used when the movie is not playing
+         *
+         * @param pixels a buffer of getSize().x * getSize().y * 4 bytes receiving the RGBA pixels of
+         * the frame, or nullptr to only update getCurrentImage()
+         * @param timestamp if not nullptr, receives the presentation time of the frame
+         * @return true if a frame was decoded, false at the end of the media or on error
+         */
+        bool nextFrame(sf::Uint8* pixels, sf::Time* timestamp = nullptr);
+        
+        /** @brief Decodes the video frame with the given index, counted from the beginning of the media
+         *
+         * The media can only be rewound to its beginning: going back to an earlier frame decodes
+         * again every frame up to it, and going forward decodes every frame in between. This is
+         * frame accurate but not fast, use nextFrame() to read frames in order.
+         *
+         * @warning This method can only be used when the movie is not playing
+         *
+         * @param index the index of the frame, 0 being the first one
+         * @param pixels a buffer of getSize().x * getSize().y * 4 bytes receiving the RGBA pixels of
+         * the frame, or nullptr to only update getCurrentImage()
+         * @param timestamp if not nullptr, receives the presentation time of the frame
+         * @return true if the frame was decoded, false if the media has less frames or on error
+         */
+        bool frameAt(sf::Uint64 index, sf::Uint8* pixels, sf::Time* timestamp = nullptr);
+        
+        /** @brief Sets whether the movie should loop after reaching the end
+         *
+         * When looping, the beginning of the media is read before its end is reached,
+         * so that playback goes on from the last frame to the first one without
+         * stopping, flushing or seeking the decoder. The playing offset keeps growing
+         * across loops. The default is to not loop.
+         *
+         * @param loop true to play in loop, false to play once
+         */
+        void setLoop(bool loop);
+        
+        /** @brief Tells whether the movie is in loop mode
+         *
+         * @return true if the movie is looping, false otherwise
+         */
+        bool getLoop() const;
+        
+        /** @brief Sets what drives the playback
+         *
+         * With FrameStepClock, frames are neither skipped nor repeated: a batch render can
+         * process every frame as fast as the CPU allows, and get the same frames on every run.
+         * The mode is kept when opening another media. The default is RealTimeClock.
+         *
+         * @warning This method can only be used when the movie is not playing
+         *
+         * @param mode the new clock mode
+         */
+        void setClockMode(ClockMode mode);
+        
+        /** @brief Returns what drives the playback
+         *
+         * @return the clock mode, see setClockMode()
+         */
+        ClockMode getClockMode() const;
+        
+        /** @brief Moves the playback to the given time when using ExternalClock
+         *
+         * The playback can only move forward, use stop() to go back to the beginning.
+         * The frame for this time is decoded on the next call to update().
+         *
+         * @param time the new playing offset
+         */
+        void setClockTime(sf::Time time);
+        
         /** @brief Sets the sound's volume (default is 100)
          *
          * @param volume the volume in range [0, 100]
@@ -225,6 +338,27 @@ namespace sfe
          */
         const sf::Texture& getCurrentImage() const;
         
+        /** @brief Copies the pixels of the latest decoded video frame
+         *
+         * Unlike getCurrentImage().copyToImage(), this reads the frame from the decoder's own
+         * RGBA buffer instead of downloading the texture back from VRAM.
+         *
+         * @param pixels a buffer of getSize().x * getSize().y * 4 bytes receiving the RGBA pixels
+         * @param timestamp if not nullptr, receives the presentation time of the frame
+         * @return true if a frame was copied, false if there is no video stream or no frame was
+         * decoded yet
+         */
+        bool copyCurrentFrame(sf::Uint8* pixels, sf::Time* timestamp = nullptr) const;
+        
+        /** @brief Returns where the decoding of the movie stands
+         *
+         * Meant to be polled once per frame by profiling overlays: comparing decodedFrames between
+         * two calls tells how many frames were decoded without being shown.
+         *
+         * @return the statistics of the selected video stream, all zero if there is none
+         */
+        PlaybackStatistics getPlaybackStatistics() const;
+        
         float getVideoRotation() const;
         
     private:
@@ -38,7 +38,11 @@ namespace sfe
     m_movieView(movieView),
     m_demuxer(nullptr),
     m_timer(nullptr),
-    m_videoSprite()
+    m_videoSprite(),
+    m_loop(false),
+    m_nextFrameIndex(0),
+    m_clockMode(RealTimeClock),
+    m_manualClock(std::make_shared<Timer::ManualClock>())
     {
     }
     
@@ -46,12 +50,16 @@ namespace sfe
     {
     }
     
-    bool MovieImpl::openFromFile(const std::string& filename)
+    bool MovieImpl::openFromFile(const std::string& filename, InputMode inputMode)
     {
         try
         {
             m_timer = std::make_shared<Timer>();
-            m_demuxer = std::make_shared<Demuxer>(filename, m_timer, *this);
+            m_nextFrameIndex = 0;
+            if (m_clockMode != RealTimeClock)
+                m_timer->setClock(m_manualClock);
+            m_demuxer = std::make_shared<Demuxer>(filename, m_timer, *this, inputMode);
+            m_demuxer->setLooping(m_loop);
             m_videoStreamsDesc = m_demuxer->computeStreamDescriptors(Video);
             
             std::set< std::shared_ptr<Stream> > videoStreams = m_demuxer->getStreamsOfType(Video);
@@ -174,6 +182,7 @@ namespace sfe
             }
             
             m_timer->stop();
+            m_nextFrameIndex = 0;
             update();
         }
         else
@@ -186,6 +195,17 @@ namespace sfe
     {
         if (m_demuxer && m_timer)
         {
+            // Move the clock just past the current frame so that exactly the next one gets decoded
+            if (m_clockMode == FrameStepClock && m_timer->getStatus() == Playing)
+            {
+                std::shared_ptr<VideoStream> vStream = m_demuxer->getSelectedVideoStream();
+                
+                if (vStream)
+                {
+                    m_manualClock->advance(vStream->getLastDecodedTimestamp() - m_timer->getOffset() + sf::microseconds(1));
+                }
+            }
+            
             m_demuxer->update();
             
             if (getStatus() == Stopped && m_timer->getStatus() != Stopped)
@@ -219,6 +239,132 @@ namespace sfe
         }
     }
     
+    bool MovieImpl::preload()
+    {
+        if (!m_demuxer || !m_timer)
+        {
+            sfeLogError("Movie::preload() - No media loaded, cannot preload");
+            return false;
+        }
+        
+        if (m_timer->getStatus() != Stopped)
+        {
+            sfeLogWarning("Movie::preload() - media is already started, nothing to preload");
+            return false;
+        }
+        
+        std::shared_ptr<VideoStream> vStream = m_demuxer->getSelectedVideoStream();
+        if (!vStream)
+            return false;
+        
+        vStream->preload();
+        return m_videoSprite.getTexture() != nullptr;
+    }
+    
+    bool MovieImpl::nextFrame(sf::Uint8* pixels, sf::Time* timestamp)
+    {
+        return frameAt(m_nextFrameIndex, pixels, timestamp);
+    }
+    
+    bool MovieImpl::frameAt(sf::Uint64 index, sf::Uint8* pixels, sf::Time* timestamp)
+    {
+        if (!m_demuxer || !m_timer)
+        {
+            sfeLogError("Movie::frameAt() - No media loaded, cannot decode a frame");
+            return false;
+        }
+        
+        if (m_timer->getStatus() == Playing)
+        {
+            sfeLogError("Movie::frameAt() - cannot step through the frames of a playing movie");
+            return false;
+        }
+        
+        std::shared_ptr<VideoStream> vStream = m_demuxer->getSelectedVideoStream();
+        if (!vStream)
+        {
+            sfeLogError("Movie::frameAt() - No selected video stream, cannot decode a frame");
+            return false;
+        }
+        
+        // The demuxer can only seek back to the beginning, earlier frames are decoded again from there
+        sf::Int64 target = static_cast<sf::Int64>(index);
+        if (target < vStream->getFrameIndex())
+        {
+            m_timer->seek(sf::Time::Zero);
+        }
+        
+        while (vStream->getFrameIndex() < target)
+        {
+            if (!vStream->decodeNextFrame())
+                return false;
+        }
+        
+        if (pixels)
+            vStream->copyFrame(pixels);
+        
+        if (timestamp)
+            *timestamp = vStream->getLastDecodedTimestamp();
+        
+        m_nextFrameIndex = index + 1;
+        return true;
+    }
+    
+    void MovieImpl::setLoop(bool loop)
+    {
+        m_loop = loop;
+        
+        if (m_demuxer)
+            m_demuxer->setLooping(loop);
+    }
+    
+    bool MovieImpl::getLoop() const
+    {
+        return m_loop;
+    }
+    
+    void MovieImpl::setClockMode(ClockMode mode)
+    {
+        if (m_timer && m_timer->getStatus() == Playing)
+        {
+            sfeLogError("Movie::setClockMode() - cannot change the clock mode of a playing movie");
+            return;
+        }
+        
+        m_clockMode = mode;
+        
+        if (m_timer)
+            m_timer->setClock(mode == RealTimeClock ? nullptr : m_manualClock);
+    }
+    
+    ClockMode MovieImpl::getClockMode() const
+    {
+        return m_clockMode;
+    }
+    
+    void MovieImpl::setClockTime(sf::Time time)
+    {
+        if (m_clockMode != ExternalClock)
+        {
+            sfeLogWarning("Movie::setClockTime() - the movie doesn't use an external clock, ignored");
+            return;
+        }
+        
+        if (!m_timer || m_timer->getStatus() != Playing)
+        {
+            sfeLogWarning("Movie::setClockTime() - the movie is not playing, ignored");
+            return;
+        }
+        
+        if (time < m_timer->getOffset())
+        {
+            sfeLogWarning("Movie::setClockTime() - the clock can't go backwards, ignored");
+            return;
+        }
+        
+        m_manualClock->advance(time - m_timer->getOffset());
+    }
+    
     sf::Time MovieImpl::getDuration() const
     {
         if (m_demuxer && m_timer)
@@ -356,6 +502,41 @@ namespace sfe
         }
     }
     
+    bool MovieImpl::copyCurrentFrame(sf::Uint8* pixels, sf::Time* timestamp) const
+    {
+        if (!m_demuxer)
+        {
+            sfeLogError("Movie::copyCurrentFrame() - No media loaded, cannot copy a frame");
+            return false;
+        }
+        
+        std::shared_ptr<VideoStream> vStream = m_demuxer->getSelectedVideoStream();
+        if (!vStream || vStream->getFrameIndex() < 0)
+            return false;
+        
+        vStream->copyFrame(pixels);
+        
+        if (timestamp)
+            *timestamp = vStream->getLastDecodedTimestamp();
+        
+        return true;
+    }
+    
+    PlaybackStatistics MovieImpl::getPlaybackStatistics() const
+    {
+        PlaybackStatistics statistics = {0, 0, sf::Time::Zero};
+        std::shared_ptr<VideoStream> vStream = m_demuxer ? m_demuxer->getSelectedVideoStream() : nullptr;
+        
+        if (vStream)
+        {
+            statistics.queuedVideoPackets = vStream->getQueuedPacketCount();
+            statistics.decodedFrames = vStream->getFrameIndex() + 1;
+            statistics.synchronizationGap = vStream->getSynchronizationGap();
+        }
+        
+        return statistics;
+    }
+    
     float MovieImpl::getVideoRotation() const
     {
         if (auto videoStream = m_demuxer->getSelectedVideoStream()) {
@@ -50,9 +50,10 @@ namespace sfe
          * video or audio stream.
          *
          * @param filename the path to the media file
+         * @param inputMode how the file should be read
          * @return true on success, false otherwise
          */
-        bool openFromFile(const std::string& filename);
+        bool openFromFile(const std::string& filename, InputMode inputMode);
         
         
         /** Return a description of all the streams of the given type contained in the opened media
@@ -105,6 +106,67 @@ namespace sfe
         void update();
         
         
+        /** Decode the first image of a stopped movie ahead of play()
+         *
+         * @return true if an image could be decoded, false otherwise
+         */
+        bool preload();
+        
+        
+        /** Decodes the frame following the last one returned by nextFrame() or frameAt()
+         *
+         * @param pixels a buffer receiving the RGBA pixels, or nullptr
+         * @param timestamp if not nullptr, receives the presentation time of the frame
+         * @return true if a frame was decoded
+         */
+        bool nextFrame(sf::Uint8* pixels, sf::Time* timestamp);
+        
+        
+        /** Decodes the frame with the given index
+         *
+         * @param index the index of the frame, 0 being the first one
+         * @param pixels a buffer receiving the RGBA pixels, or nullptr
+         * @param timestamp if not nullptr, receives the presentation time of the frame
+         * @return true if the frame was decoded
+         */
+        bool frameAt(sf::Uint64 index, sf::Uint8* pixels, sf::Time* timestamp);
+        
+        
+        /** Sets whether the movie should loop after reaching the end
+         *
+         * @param loop true to play in loop, false to play once
+         */
+        void setLoop(bool loop);
+        
+        
+        /** Tells whether the movie is in loop mode
+         *
+         * @return true if the movie is looping, false otherwise
+         */
+        bool getLoop() const;
+        
+        
+        /** Sets what drives the playback, see Movie::setClockMode()
+         *
+         * @param mode the new clock mode
+         */
+        void setClockMode(ClockMode mode);
+        
+        
+        /** Returns what drives the playback
+         *
+         * @return the clock mode
+         */
+        ClockMode getClockMode() const;
+        
+        
+        /** Moves the playback to the given time when using ExternalClock
+         *
+         * @param time the new playing offset
+         */
+        void setClockTime(sf::Time time);
+        
+        
         /** Sets the sound's volume (default is 100)
          *
          * @param volume the volume in range [0, 100]
@@ -199,6 +261,19 @@ namespace sfe
          */
         const sf::Texture& getCurrentImage() const;
         
+        
+        /** Copies the pixels of the latest decoded video frame
+         *
+         * @param pixels a buffer receiving the RGBA pixels
+         * @param timestamp if not nullptr, receives the presentation time of the frame
+         * @return true if a frame was copied
+         */
+        bool copyCurrentFrame(sf::Uint8* pixels, sf::Time* timestamp) const;
+        
+        /** @see Movie::getPlaybackStatistics()
+         */
+        PlaybackStatistics getPlaybackStatistics() const;
+        
         void draw(sf::RenderTarget& target, sf::RenderStates states) const;
         void didUpdateVideo(const VideoStream& sender, const sf::Texture& image);
         
@@ -212,6 +287,10 @@ namespace sfe
         Streams m_audioStreamsDesc;
         Streams m_videoStreamsDesc;
         sf::FloatRect m_displayFrame;
+        bool m_loop;
+        sf::Uint64 m_nextFrameIndex;
+        ClockMode m_clockMode;
+        std::shared_ptr<Timer::ManualClock> m_manualClock;
         LayoutDebugger<sf::Sprite> m_debugger;
     };
     
@@ -138,6 +138,12 @@ namespace sfe
         return result;
     }
     
+    std::size_t Stream::getQueuedPacketCount()
+    {
+        sf::Lock l(m_readerMutex);
+        return m_packetList.size();
+    }
+    
     void Stream::flushBuffers()
     {
         sf::Lock l(m_readerMutex);
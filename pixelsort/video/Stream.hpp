@@ -107,6 +107,12 @@ namespace sfe
          */
         virtual bool needsMoreData() const;
         
+        /** Tell how many encoded packets wait in the queue of this stream
+         *
+         * @return the number of queued packets
+         */
+        std::size_t getQueuedPacketCount();
+        
         /** Get the stream kind (either audio, video or subtitle stream)
          *
          * @return the kind of stream represented by this stream
@@ -60,10 +60,50 @@ namespace sfe
     {
     }
     
+    Timer::Clock::~Clock()
+    {
+    }
+    
+    sf::Time Timer::WallClock::getElapsedTime() const
+    {
+        return m_clock.getElapsedTime();
+    }
+    
+    void Timer::WallClock::restart()
+    {
+        m_clock.restart();
+    }
+    
+    Timer::ManualClock::ManualClock() :
+    m_elapsedTime(sf::Time::Zero)
+    {
+    }
+    
+    sf::Time Timer::ManualClock::getElapsedTime() const
+    {
+        return m_elapsedTime;
+    }
+    
+    void Timer::ManualClock::restart()
+    {
+        m_elapsedTime = sf::Time::Zero;
+    }
+    
+    void Timer::ManualClock::setElapsedTime(sf::Time elapsedTime)
+    {
+        m_elapsedTime = elapsedTime;
+    }
+    
+    void Timer::ManualClock::advance(sf::Time delta)
+    {
+        if (delta > sf::Time::Zero)
+            m_elapsedTime += delta;
+    }
+    
     Timer::Timer() :
     m_pausedTime(sf::Time::Zero),
     m_status(Stopped),
-    m_timer(),
+    m_clock(std::make_shared<WallClock>()),
     m_observers()
     {
     }
@@ -103,7 +143,7 @@ namespace sfe
         
         Status oldStatus = getStatus();
         m_status = Playing;
-        m_timer.restart();
+        m_clock->restart();
         
         notifyObservers(oldStatus, getStatus());
     }
@@ -114,7 +154,7 @@ namespace sfe
         
         Status oldStatus = getStatus();
         m_status = Paused;
-        m_pausedTime += m_timer.getElapsedTime();
+        m_pausedTime += m_clock->getElapsedTime();
         
         notifyObservers(oldStatus, getStatus());
     }
@@ -148,6 +188,21 @@ namespace sfe
             play();
     }
     
+    void Timer::setClock(std::shared_ptr<Clock> clock)
+    {
+        CHECK(getStatus() != Playing, "Timer::setClock() - cannot change the clock of a playing timer");
+        
+        if (clock)
+            m_clock = clock;
+        else
+            m_clock = std::make_shared<WallClock>();
+    }
+    
+    std::shared_ptr<Timer::Clock> Timer::getClock() const
+    {
+        return m_clock;
+    }
+    
     Status Timer::getStatus() const
     {
         return m_status;
@@ -156,7 +211,7 @@ namespace sfe
     sf::Time Timer::getOffset() const
     {
         if (Timer::getStatus() == Playing)
-            return m_pausedTime + m_timer.getElapsedTime();
+            return m_pausedTime + m_clock->getElapsedTime();
         else
             return m_pausedTime;
     }
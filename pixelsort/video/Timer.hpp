@@ -26,6 +26,7 @@
 #define SFEMOVIE_TIMER_HPP
 
 #include <set>
+#include <memory>
 #include <SFML/System.hpp>
 #include "Movie.hpp"
 
@@ -93,6 +94,74 @@ namespace sfe
             virtual void didSeek(const Timer& timer, sf::Time oldPosition);
         };
         
+        /** Source of time for a timer
+         *
+         * By default a timer follows the wall clock. Replacing its clock lets the
+         * streams be driven by another notion of time, eg. a virtual time that
+         * advances as fast as frames can be processed
+         */
+        class Clock
+        {
+        public:
+            /** Default destructor
+             */
+            virtual ~Clock();
+            
+            /** Return the time elapsed since the last call to restart()
+             *
+             * @return the elapsed time
+             */
+            virtual sf::Time getElapsedTime() const = 0;
+            
+            /** Reset the elapsed time to zero, called whenever the timer starts playing
+             */
+            virtual void restart() = 0;
+        };
+        
+        /** Clock following the wall time, the default clock of a timer
+         */
+        class WallClock : public Clock
+        {
+        public:
+            sf::Time getElapsedTime() const;
+            void restart();
+            
+        private:
+            sf::Clock m_clock;
+        };
+        
+        /** Clock that only moves when told to
+         *
+         * This lets the streams be driven frame by frame or by an external
+         * source of time (eg. an audio device or a render loop), at whatever pace
+         * the caller can keep up
+         */
+        class ManualClock : public Clock
+        {
+        public:
+            /** Default constructor
+             */
+            ManualClock();
+            
+            sf::Time getElapsedTime() const;
+            void restart();
+            
+            /** Set the time elapsed since the last restart
+             *
+             * @param elapsedTime the new elapsed time
+             */
+            void setElapsedTime(sf::Time elapsedTime);
+            
+            /** Move the clock forward
+             *
+             * @param delta the time to add to the elapsed time, negative values are ignored
+             */
+            void advance(sf::Time delta);
+            
+        private:
+            sf::Time m_elapsedTime;
+        };
+        
         /** Default constructor
          */
         Timer();
@@ -136,6 +205,20 @@ namespace sfe
          */
         void seek(sf::Time position);
         
+        /** Replace the source of time of this timer
+         *
+         * @warning This can only be done while the timer is not playing
+         *
+         * @param clock the new clock, or nullptr to go back to the wall clock
+         */
+        void setClock(std::shared_ptr<Clock> clock);
+        
+        /** Return the source of time of this timer
+         *
+         * @return the clock given to setClock(), or the default wall clock
+         */
+        std::shared_ptr<Clock> getClock() const;
+        
         /** Return this timer status
          *
          * @return Playing, Paused or Stopped
@@ -177,7 +260,7 @@ namespace sfe
         
         sf::Time m_pausedTime;
         Status m_status;
-        sf::Clock m_timer;
+        std::shared_ptr<Clock> m_clock;
         std::set<Observer*> m_observers;
     };
 }
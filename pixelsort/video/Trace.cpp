@@ -0,0 +1,325 @@
+/*
+ *  Trace.cpp
+ *  sfeMovie project
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <pthread.h>
+#include <SFML/System.hpp>
+
+namespace sfe
+{
+    namespace Trace
+    {
+        std::atomic<bool> g_enabled(false);
+
+        namespace
+        {
+            struct Event
+            {
+                const char* name;
+                sf::Int64 start;
+                sf::Int64 end;
+            };
+
+            struct Total
+            {
+                const char* name;
+                sf::Int64 duration;
+                long count;
+            };
+
+            struct ThreadBuffer
+            {
+                sf::Mutex mutex;
+                unsigned id;
+                std::string name;
+                std::vector<Event> events;
+                std::size_t next;
+                bool wrapped;
+                bool finished;
+                std::vector<Total> totals;
+            };
+
+            // The buffer of a thread that ended keeps its events until a new thread takes
+            // it over, so that threads that come and go, like the movie preloading ones,
+            // don't make the trace grow without bounds.
+            sf::Mutex g_registrySynchronized;
+            std::vector<ThreadBuffer*> g_buffers;
+            std::atomic<std::size_t> g_capacity(65536);
+            std::atomic<bool> g_recording(false);
+            std::atomic<bool> g_summarizing(false);
+            unsigned g_nextThreadId = 1;
+
+            pthread_key_t g_bufferKey;
+            pthread_once_t g_bufferKeyOnce = PTHREAD_ONCE_INIT;
+
+            void updateEnabled()
+            {
+                g_enabled.store(g_recording.load(std::memory_order_relaxed) || g_summarizing.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+            }
+
+            void threadDidExit(void* buffer)
+            {
+                sf::Lock l(g_registrySynchronized);
+                static_cast<ThreadBuffer*>(buffer)->finished = true;
+            }
+
+            void createBufferKey()
+            {
+                pthread_key_create(&g_bufferKey, threadDidExit);
+            }
+
+            ThreadBuffer& threadBuffer()
+            {
+                pthread_once(&g_bufferKeyOnce, createBufferKey);
+                ThreadBuffer* buffer = static_cast<ThreadBuffer*>(pthread_getspecific(g_bufferKey));
+
+                if (!buffer)
+                {
+                    sf::Lock l(g_registrySynchronized);
+
+                    for (ThreadBuffer* candidate : g_buffers)
+                    {
+                        if (candidate->finished)
+                        {
+                            buffer = candidate;
+                            break;
+                        }
+                    }
+
+                    if (!buffer)
+                    {
+                        buffer = new ThreadBuffer;
+                        g_buffers.push_back(buffer);
+                    }
+
+                    sf::Lock bufferLock(buffer->mutex);
+                    buffer->id = g_nextThreadId++;
+                    buffer->name = "thread " + std::to_string(buffer->id);
+                    buffer->next = 0;
+                    buffer->wrapped = false;
+                    buffer->finished = false;
+                    buffer->totals.clear();
+                    pthread_setspecific(g_bufferKey, buffer);
+                }
+
+                return *buffer;
+            }
+
+            // Zone names are literals from the code, only quotes and backslashes need escaping
+            void writeString(FILE* file, const std::string& string)
+            {
+                std::fputc('"', file);
+                for (char c : string)
+                {
+                    if (c == '"' || c == '\\')
+                        std::fputc('\\', file);
+                    std::fputc(c, file);
+                }
+                std::fputc('"', file);
+            }
+        }
+
+        void setEnabled(bool enabled)
+        {
+            g_recording.store(enabled, std::memory_order_relaxed);
+            updateEnabled();
+        }
+
+        void setSummaryEnabled(bool enabled)
+        {
+            g_summarizing.store(enabled, std::memory_order_relaxed);
+            updateEnabled();
+        }
+
+        void setThreadName(const std::string& name)
+        {
+            ThreadBuffer& buffer = threadBuffer();
+            sf::Lock l(buffer.mutex);
+            buffer.name = name;
+        }
+
+        void setThreadCapacity(std::size_t capacity)
+        {
+            g_capacity = capacity > 0 ? capacity : 1;
+        }
+
+        bool writeChromeTrace(const std::string& path)
+        {
+            struct ThreadEvents
+            {
+                unsigned id;
+                std::string name;
+                std::vector<Event> events;
+            };
+
+            // Copied out first, threads only wait for the copy of their own events
+            std::vector<ThreadEvents> threads;
+            {
+                sf::Lock l(g_registrySynchronized);
+
+                for (ThreadBuffer* buffer : g_buffers)
+                {
+                    sf::Lock bufferLock(buffer->mutex);
+                    ThreadEvents thread = {buffer->id, buffer->name, std::vector<Event>()};
+
+                    if (buffer->wrapped)
+                        thread.events.insert(thread.events.end(), buffer->events.begin() + buffer->next, buffer->events.end());
+                    thread.events.insert(thread.events.end(), buffer->events.begin(), buffer->events.begin() + buffer->next);
+                    threads.push_back(thread);
+                }
+            }
+
+            FILE* file = std::fopen(path.c_str(), "w");
+            if (!file)
+                return false;
+
+            std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+            bool first = true;
+
+            for (const ThreadEvents& thread : threads)
+            {
+                std::fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ",
+                             first ? "" : ",\n", thread.id);
+                writeString(file, thread.name);
+                std::fprintf(file, "}}");
+                first = false;
+
+                for (const Event& event : thread.events)
+                {
+                    std::fprintf(file, ",\n{\"name\": ");
+                    writeString(file, event.name);
+                    std::fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                                 thread.id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+                }
+            }
+
+            std::fprintf(file, "\n]}\n");
+            return std::fclose(file) == 0;
+        }
+
+        void clear()
+        {
+            sf::Lock l(g_registrySynchronized);
+
+            for (ThreadBuffer* buffer : g_buffers)
+            {
+                sf::Lock bufferLock(buffer->mutex);
+                buffer->next = 0;
+                buffer->wrapped = false;
+            }
+        }
+
+        std::vector<ZoneTotal> takeSummary(const std::vector<std::string>& threadNames)
+        {
+            std::vector<ZoneTotal> summary;
+            sf::Lock l(g_registrySynchronized);
+
+            for (ThreadBuffer* buffer : g_buffers)
+            {
+                sf::Lock bufferLock(buffer->mutex);
+                bool listed = threadNames.empty() ||
+                    std::find(threadNames.begin(), threadNames.end(), buffer->name) != threadNames.end();
+
+                // The same literal may have several addresses, totals are merged by name
+                for (Total& total : buffer->totals)
+                {
+                    if (total.count == 0)
+                        continue;
+
+                    if (!listed)
+                    {
+                        total.duration = 0;
+                        total.count = 0;
+                        continue;
+                    }
+
+                    std::size_t i = 0;
+                    while (i < summary.size() && summary[i].name != total.name)
+                        i++;
+
+                    if (i == summary.size())
+                    {
+                        ZoneTotal zone = {total.name, 0, 0};
+                        summary.push_back(zone);
+                    }
+
+                    summary[i].duration += total.duration;
+                    summary[i].count += total.count;
+                    total.duration = 0;
+                    total.count = 0;
+                }
+            }
+
+            return summary;
+        }
+
+        void record(const char* name, sf::Int64 start, sf::Int64 end)
+        {
+            ThreadBuffer& buffer = threadBuffer();
+            sf::Lock l(buffer.mutex);
+
+            if (g_recording.load(std::memory_order_relaxed))
+            {
+                // Allocated on the first event, threads that are only named cost nothing
+                if (buffer.events.empty())
+                    buffer.events.resize(g_capacity);
+
+                Event& event = buffer.events[buffer.next];
+                event.name = name;
+                event.start = start;
+                event.end = end;
+
+                if (++buffer.next == buffer.events.size())
+                {
+                    buffer.next = 0;
+                    buffer.wrapped = true;
+                }
+            }
+
+            if (g_summarizing.load(std::memory_order_relaxed))
+            {
+                // A thread only ever sees a handful of zone names
+                std::size_t i = 0;
+                while (i < buffer.totals.size() && buffer.totals[i].name != name)
+                    i++;
+
+                if (i == buffer.totals.size())
+                {
+                    Total total = {name, 0, 0};
+                    buffer.totals.push_back(total);
+                }
+
+                buffer.totals[i].duration += end - start;
+                buffer.totals[i].count++;
+            }
+        }
+
+        sf::Int64 now()
+        {
+            static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+        }
+    }
+}
@@ -0,0 +1,164 @@
+/*
+ *  Trace.hpp
+ *  sfeMovie project
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef SFEMOVIE_TRACE_HPP
+#define SFEMOVIE_TRACE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <SFML/Config.hpp>
+
+#define SFE_TRACE_CONCAT_(a, b) a##b
+#define SFE_TRACE_CONCAT(a, b) SFE_TRACE_CONCAT_(a, b)
+
+/** Time the rest of the enclosing scope as a zone called @a name, which must be a string literal
+ */
+#define sfeTraceZone(name) sfe::Trace::Zone SFE_TRACE_CONCAT(__sfeTraceZone, __LINE__)(name)
+
+namespace sfe
+{
+    /** Tracing of where the time of a frame goes
+     *
+     * Zones are scopes timed with sfeTraceZone(). While tracing is enabled, every zone
+     * that ends is recorded in a ring buffer of the thread it ran on, which keeps the
+     * latest events of that thread only. Threads don't share anything when recording
+     * but the lock of their own buffer, which nobody else takes outside of a dump.
+     * While tracing is disabled, a zone costs a relaxed atomic load.
+     *
+     * The buffered events of all threads can be written at any time as a Chrome trace
+     * (JSON trace event format), which chrome://tracing and ui.perfetto.dev open.
+     *
+     * Independently of the ring buffers, zones can also be summed up per name, for
+     * overlays that show every frame how long its stages took without keeping events.
+     */
+    namespace Trace
+    {
+        /** Start or stop recording zones
+         *
+         * @param enabled true to record zones
+         */
+        void setEnabled(bool enabled);
+
+        /** Start or stop summing up zones, see takeSummary()
+         *
+         * @param enabled true to sum up zones
+         */
+        void setSummaryEnabled(bool enabled);
+
+        // Set while zones are recorded or summed up, inline so that disabled zones cost no call
+        extern std::atomic<bool> g_enabled;
+
+        /** Tell whether zones are timed, to be recorded or summed up
+         *
+         * @return true if zones are timed
+         */
+        inline bool isEnabled()
+        {
+            return g_enabled.load(std::memory_order_relaxed);
+        }
+
+        /** Name the calling thread in the traces
+         *
+         * @param name the name of the thread, like "main" or "decoder"
+         */
+        void setThreadName(const std::string& name);
+
+        /** Set how many events every thread keeps, only affects threads that didn't record yet
+         *
+         * @param capacity the number of events kept per thread, 65536 by default
+         */
+        void setThreadCapacity(std::size_t capacity);
+
+        /** Write the buffered events of all threads as a Chrome trace
+         *
+         * @param path the JSON file to write
+         * @return true on success
+         */
+        bool writeChromeTrace(const std::string& path);
+
+        /** Forget the buffered events of all threads
+         */
+        void clear();
+
+        /** Time spent in the zones of a name, over all threads
+         */
+        struct ZoneTotal
+        {
+            std::string name;
+            sf::Int64 duration; //!< Nanoseconds
+            long count;         //!< Number of zones that ended
+        };
+
+        /** Return the zones summed up since the previous call, and start over
+         *
+         * Zones that didn't end in between are left out. Zones of threads that aren't
+         * listed are dropped, so that loading threads don't count as frame work.
+         *
+         * @param threadNames the names of the threads to sum up, see setThreadName(),
+         * every thread if empty
+         * @return one total per zone name
+         */
+        std::vector<ZoneTotal> takeSummary(const std::vector<std::string>& threadNames = std::vector<std::string>());
+
+        /** Record or sum up a zone that ran from @a start to @a end, in nanoseconds from now()
+         *
+         * @param name the name of the zone, a string literal
+         */
+        void record(const char* name, sf::Int64 start, sf::Int64 end);
+
+        /** Return the time elapsed since the first call in nanoseconds, from a monotonic clock
+         */
+        sf::Int64 now();
+
+        /** Scope recorded as a zone, see sfeTraceZone()
+         */
+        class Zone
+        {
+        public:
+            explicit Zone(const char* name) :
+            m_name(nullptr),
+            m_start(0)
+            {
+                if (isEnabled())
+                {
+                    m_name = name;
+                    m_start = now();
+                }
+            }
+
+            ~Zone()
+            {
+                if (m_name)
+                    record(m_name, m_start, now());
+            }
+
+        private:
+            Zone(const Zone&);
+            Zone& operator=(const Zone&);
+
+            const char* m_name;
+            sf::Int64 m_start;
+        };
+    }
+}
+
+#endif
@@ -34,6 +34,8 @@ extern "C"
 #include "VideoStream.hpp"
 #include "Utilities.hpp"
 #include "Log.hpp"
+#include "Trace.hpp"
+#include <cstring>
 
 namespace sfe
 {
@@ -46,7 +48,9 @@ namespace sfe
     m_rgbaVideoLinesize(),
     m_delegate(delegate),
     m_swsCtx(nullptr),
-    m_lastDecodedTimestamp(sf::Time::Zero)
+    m_lastDecodedTimestamp(sf::Time::Zero),
+    m_preloaded(false),
+    m_frameIndex(-1)
     {
         int err;
         
@@ -66,8 +70,11 @@ namespace sfe
         CHECK(err >= 0, "VideoStream() - av_image_alloc() error");
         
         // SFML video frame
-        err = m_texture.create(m_stream->codec->width, m_stream->codec->height);
-        CHECK(err, "VideoStream() - sf::Texture::create() error");
+        if (m_delegate.usesVideoTexture())
+        {
+            err = m_texture.create(m_stream->codec->width, m_stream->codec->height);
+            CHECK(err, "VideoStream() - sf::Texture::create() error");
+        }
         
         initRescaler();
 
@@ -155,7 +162,14 @@ namespace sfe
                 if (gotFrame)
                 {
                     rescale(m_rawVideoFrame, m_rgbaVideoBuffer, m_rgbaVideoLinesize);
-                    texture.update(m_rgbaVideoBuffer[0]);
+                    m_frameIndex++;
+                    m_delegate.didDecodeVideo(*this, m_rgbaVideoBuffer[0], m_lastDecodedTimestamp);
+                    
+                    if (m_delegate.usesVideoTexture())
+                    {
+                        sfeTraceZone("texture upload");
+                        texture.update(m_rgbaVideoBuffer[0]);
+                    }
                 }
                 
                 if (needsMoreDecoding)
@@ -179,6 +193,39 @@ namespace sfe
         return goOn;
     }
     
+    sf::Time VideoStream::getLastDecodedTimestamp() const
+    {
+        return m_lastDecodedTimestamp;
+    }
+    
+    bool VideoStream::decodeNextFrame()
+    {
+        sf::Int64 previousIndex = m_frameIndex;
+        
+        while (m_frameIndex == previousIndex)
+        {
+            if (!onGetData(m_texture))
+                return false;
+        }
+        
+        m_delegate.didUpdateVideo(*this, m_texture);
+        return true;
+    }
+    
+    sf::Int64 VideoStream::getFrameIndex() const
+    {
+        return m_frameIndex;
+    }
+    
+    void VideoStream::copyFrame(sf::Uint8* pixels) const
+    {
+        CHECK(pixels, "VideoStream::copyFrame() - invalid argument");
+        sfeTraceZone("readback");
+        
+        // The RGBA buffer is allocated without any row padding
+        std::memcpy(pixels, m_rgbaVideoBuffer[0], m_stream->codec->width * m_stream->codec->height * 4);
+    }
+    
     sf::Time VideoStream::getSynchronizationGap()
     {
         return  m_lastDecodedTimestamp - m_timer->getOffset();
@@ -186,6 +233,7 @@ namespace sfe
     
     bool VideoStream::decodePacket(AVPacket* packet, AVFrame* outputFrame, bool& gotFrame, bool& needsMoreDecoding)
     {
+        sfeTraceZone("decode");
         int gotPicture = 0;
         needsMoreDecoding = false;
         
@@ -236,13 +284,21 @@ namespace sfe
     void VideoStream::rescale(AVFrame* frame, uint8_t* outVideoBuffer[4], int outVideoLinesize[4])
     {
         CHECK(frame, "VideoStream::rescale() - invalid argument");
+        sfeTraceZone("sws_scale");
         sws_scale(m_swsCtx, frame->data, frame->linesize, 0, frame->height, outVideoBuffer, outVideoLinesize);
     }
     
     void VideoStream::preload()
     {
+        if (m_preloaded)
+            return;
+        
         sfeLogDebug("Preload video image");
-        onGetData(m_texture);
+        if (onGetData(m_texture))
+        {
+            m_preloaded = true;
+            m_delegate.didUpdateVideo(*this, m_texture);
+        }
     }
     
     void VideoStream::willPlay(const Timer &timer)
@@ -253,4 +309,13 @@ namespace sfe
             preload();
         }
     }
+    
+    void VideoStream::didSeek(const Timer& timer, sf::Time oldPosition)
+    {
+        Stream::didSeek(timer, oldPosition);
+        
+        // The preloaded image belongs to the previous position
+        m_preloaded = false;
+        m_frameIndex = -1;
+    }
 }
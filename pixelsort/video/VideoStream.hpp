@@ -38,6 +38,24 @@ namespace sfe
         struct Delegate
         {
             virtual void didUpdateVideo(const VideoStream& sender, const sf::Texture& image) = 0;
+            
+            /** Called for every decoded frame with its RGBA pixels
+             *
+             * @param sender the stream that decoded the frame
+             * @param pixels the frame pixels, tightly packed RGBA, only valid during the call
+             * @param timestamp the presentation timestamp of the frame
+             */
+            virtual void didDecodeVideo(const VideoStream& sender, const sf::Uint8* pixels, sf::Time timestamp) {}
+            
+            /** Tell whether decoded frames should be uploaded to the stream's texture
+             *
+             * Delegates that only read the pixels given to didDecodeVideo() can return false,
+             * so that no texture is ever created and the stream can be used without any
+             * graphics context (eg. on a machine with no display)
+             *
+             * @return true to use a texture, false otherwise
+             */
+            virtual bool usesVideoTexture() const { return true; }
         };
         
         /** Create a video stream from the given FFmpeg stream
@@ -72,6 +90,8 @@ namespace sfe
         float getFrameRate() const;
         
         /** Get the SFML texture that contains the latest video frame
+         *
+         * The texture is empty if the delegate doesn't use textures
          */
         sf::Texture& getVideoTexture();
         
@@ -82,8 +102,42 @@ namespace sfe
         /** Update the video frame and the stream's status
          */
         virtual void update();
-    private:
-        bool onGetData(sf::Texture& texture);
+        
+        /** Load packets until one frame can be decoded
+         *
+         * The decoded frame is kept and shown when playing starts, so that a stopped
+         * stream can be prepared ahead of time (eg. from a loading thread)
+         */
+        void preload();
+        
+        /** Return the timestamp of the last decoded frame
+         *
+         * The stream decodes its next frame once the timer goes past this time
+         *
+         * @return the presentation time of the current frame
+         */
+        sf::Time getLastDecodedTimestamp() const;
+        
+        /** Decode exactly one frame, whatever the timer says
+         *
+         * The frame is kept as the current frame of the stream and sent to the delegate
+         * as if it had been decoded by update()
+         *
+         * @return true if a frame was decoded, false at the end of the stream
+         */
+        bool decodeNextFrame();
+        
+        /** Return the index of the current frame, counted from the beginning of the media
+         *
+         * @return the frame index, or -1 if no frame was decoded since the beginning
+         */
+        sf::Int64 getFrameIndex() const;
+        
+        /** Copy the current frame as RGBA pixels
+         *
+         * @param pixels a buffer of getFrameSize().x * getFrameSize().y * 4 bytes
+         */
+        void copyFrame(sf::Uint8* pixels) const;
         
         /** Returns the difference between the video stream timer and the reference timer
          *
@@ -91,6 +145,8 @@ namespace sfe
          * whereas a nevatige value means the video stream is late
          */
         sf::Time getSynchronizationGap();
+    private:
+        bool onGetData(sf::Texture& texture);
         
         /** Decode the encoded data @a packet into @a outputFrame
          *
@@ -121,12 +177,9 @@ namespace sfe
          */
         void rescale(AVFrame* frame, uint8_t* outVideoBuffer[4], int outVideoLinesize[4]);
         
-        /** Load packets until one frame can be decoded
-         */
-        void preload();
-        
         // Timer::Observer interface
         void willPlay(const Timer &timer);
+        void didSeek(const Timer& timer, sf::Time oldPosition);
         
         // Private data
         sf::Texture m_texture;
@@ -141,6 +194,8 @@ namespace sfe
         sf::Time m_lastDecodedTimestamp;
         
         float m_rotation = 0.0f;
+        bool m_preloaded;
+        sf::Int64 m_frameIndex;
     };
 }
 
@@ -4,6 +4,8 @@
 #include <iostream>
 #include <SFML/Graphics.hpp>
 
+#include "sortdispatch.h"
+
 using namespace std;
 using namespace sf;
 
@@ -340,9 +342,65 @@ int comp( const void* a, const void* b ) {
 }
 
 
-void sortRun(Uint32* pixels, const Vector2u& size, const VectorPixels& run, Uint8 blackValue)
+double SegmentStats::getSkippedFraction() const
+{
+    if (visitedPixels <= 0)
+        return 0;
+    return static_cast<double>(visitedPixels - sortedPixels) / visitedPixels;
+}
+
+SegmentStats& SegmentStats::operator+=(const SegmentStats& other)
+{
+    segments += other.segments;
+    sortedPixels += other.sortedPixels;
+    visitedPixels += other.visitedPixels;
+    for (int i = 0; i < HistogramBuckets; ++i)
+        lengthHistogram[i] += other.lengthHistogram[i];
+    return *this;
+}
+
+int SegmentStats::getBucket(unsigned long length)
+{
+    int bucket = static_cast<int>(sizeof(length) * 8 - 1) - __builtin_clzl(length);
+    return min(bucket, HistogramBuckets - 1);
+}
+
+static inline void addSegment(SegmentStats& stats, int sortLength)
+{
+    if (sortLength <= 0)
+        return;
+
+    stats.segments++;
+    stats.sortedPixels += sortLength;
+    stats.lengthHistogram[SegmentStats::getBucket(sortLength)]++;
+}
+
+// Working memory of a kernel, kept from one segment to the next
+struct SortBuffers
+{
+    std::vector<Uint32> scratch;
+    std::vector<Uint64> records;
+    std::vector<Uint64> recordScratch;
+};
+
+static void sortSegment(std::vector<Uint32>& unsorted, int sortLength, SortKey key, SortBuffers& buffers)
+{
+    if (key == RawKey) {
+        // The whole buffer is sorted, with what longer segments before left
+        // past sortLength, as it always was: the look depends on it
+        sortPixels(unsorted.data(), unsorted.size(), buffers.scratch);
+    } else if (sortLength > 0) {
+        sortPixelsByKey(unsorted.data(), sortLength, key, buffers.records, buffers.recordScratch);
+    }
+}
+
+int sortRun(Uint32* pixels, const Vector2u& size, const VectorPixels& run, Uint8 blackValue, SortKey key,
+            SegmentStats* stats)
 {
     std::vector<Uint32> unsorted;
+    SortBuffers buffers;
+    int segments = 0;
+    SegmentStats local;
     
     int index = 0;
     int indexEnd = 0;
@@ -364,37 +422,54 @@ void sortRun(Uint32* pixels, const Vector2u& size, const VectorPixels& run, Uint
             unsorted[i] = pixels[p.y * size.x + p.x];
         }
         
-        std::sort(begin(unsorted), end(unsorted));
+        sortSegment(unsorted, sortLength, key, buffers);
         
         for (int i = 0; i < sortLength; ++i) {
             const Vector2i& p = run[index + i];
             pixels[p.y * size.x + p.x] = unsorted[i];
         }
         
+        if (sortLength > 0)
+            segments++;
+        if (stats)
+            addSegment(local, sortLength);
         index = indexEnd + 1;
     }
+
+    if (stats) {
+        local.visitedPixels = run.size();
+        *stats += local;
+    }
+    return segments;
 }
 
 
-void sortRuns(Image& image, const vector<VectorPixels>& runs, Uint8 blackValue)
+int sortRuns(Uint32* pixels, const Vector2u& size, const vector<VectorPixels>& runs, Uint8 blackValue,
+             SortKey key, SegmentStats* stats)
 {
-    Uint32* pixels = getWritablePixels(image);
+    int segments = 0;
+    SegmentStats local;
     for (auto run : runs) {
-        sortRun(pixels, image.getSize(), run, blackValue);
+        segments += sortRun(pixels, size, run, blackValue, key, stats ? &local : nullptr);
     }
+
+    if (stats)
+        *stats += local;
+    return segments;
 }
 
-void sortCol(Image& image, int column, Uint8 blackValue)
+int sortCol(Uint32* pixels, const Vector2u& size, int column, Uint8 blackValue, SortKey key, SegmentStats* stats)
 {
     int x = column;
     int y = 0;
     int yend = 0;
+    int segments = 0;
+    SegmentStats local;
     
-    Uint32* pixels = getWritablePixels(image);
-    const Vector2u& size = image.getSize();
     std::vector<Uint32> unsorted;
+    SortBuffers buffers;
     
-    while (yend < image.getSize().y - 1) {
+    while (yend < size.y - 1) {
         y = getFirstNotBlackY(pixels, size, x, y, blackValue);
         yend = getNextBlackY(pixels, size, x, y, blackValue);
         
@@ -408,26 +483,37 @@ void sortCol(Image& image, int column, Uint8 blackValue)
             unsorted[i] = pixels[(y + i) * size.x + x];
         }
         
-        std::sort(unsorted.begin(), unsorted.end());
+        sortSegment(unsorted, sortLength, key, buffers);
         
         for (int i = 0; i < sortLength; ++i) {
             pixels[(y + i) * size.x + x] = unsorted[i];
         }
         
+        if (sortLength > 0)
+            segments++;
+        if (stats)
+            addSegment(local, sortLength);
         y = yend + 1;
     }
+
+    if (stats) {
+        local.visitedPixels = size.y;
+        *stats += local;
+    }
+    return segments;
 }
 
-void sortRow(Image& image, int row, Uint8 blackValue)
+int sortRow(Uint32* pixels, const Vector2u& size, int row, Uint8 blackValue, SortKey key, SegmentStats* stats)
 {
     int x = 0;
     int y = row;
     int xend = 0;
+    int segments = 0;
+    SegmentStats local;
     
-    Uint32* pixels = reinterpret_cast<Uint32*>(const_cast<Uint8*>(image.getPixelsPtr()));
-    Uint32 pixelsWidth = image.getSize().x;
-    const Vector2u& size = image.getSize();
+    Uint32 pixelsWidth = size.x;
     std::vector<Uint32> unsorted;
+    SortBuffers buffers;
     
     while (xend < pixelsWidth - 1) {
         x = getFirstNotBlackX(pixels, size, x, y, blackValue);
@@ -443,53 +529,135 @@ void sortRow(Image& image, int row, Uint8 blackValue)
             unsorted[i] = pixels[y * pixelsWidth + (x + i)];
         }
         
-        std::sort(unsorted.begin(), unsorted.end());
+        sortSegment(unsorted, sortLength, key, buffers);
         
         for (int i = 0; i < sortLength; ++i) {
             pixels[y * pixelsWidth + (x + i)] = unsorted[i];
         }
         
+        if (sortLength > 0)
+            segments++;
+        if (stats)
+            addSegment(local, sortLength);
         x = xend + 1;
     }
+
+    if (stats) {
+        local.visitedPixels = size.x;
+        *stats += local;
+    }
+    return segments;
 }
 
 
 
+const char* getSortKeyName(SortKey key)
+{
+    static const char* names[SortKeyCount] = {"raw", "luma", "hue", "saturation", "red", "green", "blue"};
+    return key >= 0 && key < SortKeyCount ? names[key] : "";
+}
+
+bool sortKeyFromName(const string& name, SortKey& key)
+{
+    for (int i = 0; i < SortKeyCount; ++i) {
+        if (name == getSortKeyName(static_cast<SortKey>(i))) {
+            key = static_cast<SortKey>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* getSortPassName(SortPass pass)
+{
+    static const char* names[SortPassCount] = {"circles", "cols", "rows", "spirals", "random walks", "diagonals"};
+    return pass >= 0 && pass < SortPassCount ? names[pass] : "";
+}
+
+static SortTraceHooks traceHooks;
+
+// Times the rest of its scope through the trace hooks, if there are any
+class SortZone
+{
+public:
+    explicit SortZone(const char* name_)
+        : name(name_)
+        , token(traceHooks.begin ? traceHooks.begin(name_) : 0)
+    {
+    }
+
+    ~SortZone()
+    {
+        if (traceHooks.end)
+            traceHooks.end(name, token);
+    }
+
+private:
+    const char* name;
+    Int64 token;
+};
+
+void setSortTraceHooks(const SortTraceHooks& hooks)
+{
+    traceHooks = hooks;
+}
+
 void prettySort(Image& image, State& state)
 {
+    prettySort(getWritablePixels(image), image.getSize(), state);
+}
+
+void prettySort(Uint32* pixels, const Vector2u& size, State& state, SortStats* stats)
+{
+    SortZone sortZone("prettySort");
+
+    if (stats) {
+        *stats = SortStats();
+        stats->key = state.key;
+    }
+
+    // Where each pass counts its segments, nowhere without stats
+    auto passStats = [stats](SortPass pass) { return stats ? &stats->passes[pass] : nullptr; };
+
     state.circles = !state.circles;
     state.circles = !state.circles;
     
-    FloatRect imageRect(0, 0, image.getSize().x, image.getSize().y);
+    FloatRect imageRect(0, 0, size.x, size.y);
     
     if (state.circles) {
-        sortRuns(image, getManyCircles(imageRect, Vector2u(200, 200)), state.mouseX * 255);
+        SortZone zone("sort circles");
+        sortRuns(pixels, size, getManyCircles(imageRect, Vector2u(200, 200)), state.mouseX * 255, state.key, passStats(CirclesPass));
     }
     
     if (state.cols) {
+        SortZone zone("sort cols");
         for (int col = 0; col < imageRect.width; ++col) {
-            sortCol(image, col, 255 * state.mouseY);
+            sortCol(pixels, size, col, 255 * state.mouseY, state.key, passStats(ColsPass));
         }
     }
     
     if (state.rows) {
+        SortZone zone("sort rows");
         for (int row = 0; row < imageRect.height; ++row) {
-            sortRow(image, row, 255 * state.mouseX);
+            sortRow(pixels, size, row, 255 * state.mouseX, state.key, passStats(RowsPass));
         }
     }
     
     if (state.spirals) {
+        SortZone zone("sort spirals");
         float f = sin(state.time / 1000 / 5) * 400 + 400;
         int spiralSize = static_cast<int>(f);
         auto runs = getManySpirals(imageRect, Vector2u(spiralSize, spiralSize));
-        sortRuns(image, runs, state.mouseX * 255);
+        sortRuns(pixels, size, runs, state.mouseX * 255, state.key, passStats(SpiralsPass));
     }
     
     if (state.random) {
-        sortRuns(image, getRandomWalks(imageRect), state.mouseX * 255);
+        SortZone zone("sort random walks");
+        sortRuns(pixels, size, getRandomWalks(imageRect), state.mouseX * 255, state.key, passStats(RandomWalksPass));
     }
     
     if (state.diagonals) {
-        sortRuns(image, getDiagonals(imageRect, state.mouseY), state.mouseX * 255);
+        SortZone zone("sort diagonals");
+        sortRuns(pixels, size, getDiagonals(imageRect, state.mouseY), state.mouseX * 255, state.key, passStats(DiagonalsPass));
     }
 }
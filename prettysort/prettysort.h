@@ -10,6 +10,26 @@ using namespace sf;
 
 typedef vector<Vector2i> VectorPixels;
 
+// What the pixels of a segment are ordered by. Raw compares the pixels as
+// 32 bit integers, alpha then blue, green and red, which has little to do
+// with how they look but is the sorter's original look. The others compute
+// an 8 bit key once per pixel of the segment, and order pixels of equal
+// keys by their raw value.
+enum SortKey
+{
+    RawKey,
+    LumaKey,
+    HueKey,
+    SaturationKey,
+    RedKey,
+    GreenKey,
+    BlueKey,
+    SortKeyCount
+};
+
+const char* getSortKeyName(SortKey key);
+bool sortKeyFromName(const string& name, SortKey& key);
+
 struct State
 {
     float mouseX;
@@ -22,10 +42,92 @@ struct State
     bool circles = false;
     bool spirals = false;
     bool random = false;
+
+    SortKey key = RawKey;
+};
+
+// The passes of prettySort(), in the order it runs them.
+enum SortPass
+{
+    CirclesPass,
+    ColsPass,
+    RowsPass,
+    SpiralsPass,
+    RandomWalksPass,
+    DiagonalsPass,
+    SortPassCount
+};
+
+const char* getSortPassName(SortPass pass);
+
+// The runs of pixels brighter than the threshold that a pass sorted.
+struct SegmentStats
+{
+    // Segment lengths by powers of two: bucket i counts the segments of
+    // 2^i to 2^(i+1) - 1 pixels, the last one everything longer
+    static const int HistogramBuckets = 12;
+
+    long segments = 0;
+    long sortedPixels = 0;
+    long visitedPixels = 0;   // walked along the runs, sorted or not
+    long lengthHistogram[HistogramBuckets] = {};
+
+    // Of the visited pixels, those left alone for being below the
+    // threshold, 0 if none were visited
+    double getSkippedFraction() const;
+
+    // The histogram bucket of a segment of length pixels, at least 1
+    static int getBucket(unsigned long length);
+
+    SegmentStats& operator+=(const SegmentStats& other);
+};
+
+// What one prettySort() call did, pass by pass; passes that didn't run stay
+// at zero.
+struct SortStats
+{
+    SortKey key = RawKey;
+    SegmentStats passes[SortPassCount];
 };
 
 void prettySort(Image& image, State& state);
 
+// Sort tightly packed RGBA pixels in place, size.x * size.y of them, for
+// frames that don't live in an sf::Image. Fills stats if given.
+void prettySort(Uint32* pixels, const Vector2u& size, State& state, SortStats* stats = nullptr);
+
+// Lets a profiler time prettySort() and its passes without the sorter
+// depending on it. begin is called as a zone starts and returns whatever end
+// needs to know about it, like the time; both may be called from several
+// threads at once. Meant to be set once at startup, nothing is timed by
+// default.
+struct SortTraceHooks
+{
+    Int64 (*begin)(const char* name) = nullptr;
+    void (*end)(const char* name, Int64 token) = nullptr;
+};
+
+void setSortTraceHooks(const SortTraceHooks& hooks);
+
+// The building blocks of prettySort(), for the benchmarks. The get*()
+// functions return the runs of pixels to sort, the sort*() functions sort
+// the pixels brighter than blackValue along them and return how many
+// segments they sorted, adding them to stats if given. They count into a
+// SegmentStats of their own and add it to stats once on return, so that
+// threads sorting different runs can each bring their own stats and sum
+// them up afterwards.
+vector<VectorPixels> getDiagonals(const FloatRect& rect, float factor);
+vector<VectorPixels> getManyCircles(const FloatRect& rect, Vector2u size);
+vector<VectorPixels> getManySpirals(const FloatRect& rect, Vector2u size);
+vector<VectorPixels> getRandomWalks(const FloatRect& rect);
+
+int sortRuns(Uint32* pixels, const Vector2u& size, const vector<VectorPixels>& runs, Uint8 blackValue,
+             SortKey key = RawKey, SegmentStats* stats = nullptr);
+int sortRow(Uint32* pixels, const Vector2u& size, int row, Uint8 blackValue, SortKey key = RawKey,
+            SegmentStats* stats = nullptr);
+int sortCol(Uint32* pixels, const Vector2u& size, int column, Uint8 blackValue, SortKey key = RawKey,
+            SegmentStats* stats = nullptr);
+
 inline Uint32* getWritablePixels(Image& image)
 {
     return reinterpret_cast<Uint32*>(const_cast<Uint8*>(image.getPixelsPtr()));
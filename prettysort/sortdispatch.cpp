@@ -0,0 +1,356 @@
+#include "sortdispatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace sf;
+
+static const size_t NetworkSize = 32;
+
+// Enough pixels sorted per measurement that timer resolution doesn't matter
+static const size_t CalibrationPixels = 1 << 15;
+static const int CalibrationTrials = 3;
+
+static SortDispatch activeDispatch;
+
+template <typename T>
+static void insertionSort(T* pixels, size_t count)
+{
+    for (size_t i = 1; i < count; ++i) {
+        T value = pixels[i];
+        size_t j = i;
+        while (j > 0 && pixels[j - 1] > value) {
+            pixels[j] = pixels[j - 1];
+            --j;
+        }
+        pixels[j] = value;
+    }
+}
+
+static inline void compareExchange(Uint32& a, Uint32& b)
+{
+    Uint32 low = min(a, b);
+    Uint32 high = max(a, b);
+    a = low;
+    b = high;
+}
+
+// Padded to the next power of two with pixels that sort last
+static void networkSort(Uint32* pixels, size_t count)
+{
+    size_t size = 1;
+    while (size < count)
+        size <<= 1;
+
+    Uint32 padded[NetworkSize];
+    copy(pixels, pixels + count, padded);
+    fill(padded + count, padded + size, 0xFFFFFFFF);
+
+    for (size_t p = 1; p < size; p <<= 1) {
+        for (size_t k = p; k >= 1; k >>= 1) {
+            for (size_t j = k % p; j + k < size; j += 2 * k) {
+                for (size_t i = 0; i < k && i + j + k < size; ++i) {
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+                        compareExchange(padded[i + j], padded[i + j + k]);
+                }
+            }
+        }
+    }
+
+    copy(padded, padded + count, pixels);
+}
+
+// The low bytes of the values only, keyed records have 5 of their 8 in use
+template <typename T>
+static void radixSort(T* values, size_t count, vector<T>& scratch, int bytes = sizeof(T))
+{
+    size_t histograms[sizeof(T)][256] = {};
+    for (size_t i = 0; i < count; ++i) {
+        T value = values[i];
+        for (int byte = 0; byte < bytes; ++byte)
+            histograms[byte][(value >> (8 * byte)) & 0xFF]++;
+    }
+
+    if (scratch.size() < count)
+        scratch.resize(count);
+
+    T* source = values;
+    T* destination = &scratch[0];
+    for (int byte = 0; byte < bytes; ++byte) {
+        size_t* histogram = histograms[byte];
+
+        // Opaque pixels all share their alpha byte, nothing to do for it
+        if (histogram[(source[0] >> (8 * byte)) & 0xFF] == count)
+            continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            size_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            T value = source[i];
+            destination[histogram[(value >> (8 * byte)) & 0xFF]++] = value;
+        }
+        swap(source, destination);
+    }
+
+    if (source != values)
+        copy(source, source + count, values);
+}
+
+static inline Uint8 getKey(Uint32 pixel, SortKey key)
+{
+    const Uint8* channels = reinterpret_cast<const Uint8*>(&pixel);
+    int red = channels[0], green = channels[1], blue = channels[2];
+
+    switch (key) {
+        case LumaKey:
+            // Rec. 709 weights out of 256
+            return static_cast<Uint8>((54 * red + 183 * green + 19 * blue) >> 8);
+        case HueKey: {
+            int high = max(red, max(green, blue));
+            int low = min(red, min(green, blue));
+            int range = high - low;
+            if (range == 0)
+                return 0;
+
+            // A sixth of the circle per primary or secondary color, 256 steps around
+            int hue;
+            if (high == red) {
+                hue = (green - blue) * 43 / range;
+            } else if (high == green) {
+                hue = 85 + (blue - red) * 43 / range;
+            } else {
+                hue = 171 + (red - green) * 43 / range;
+            }
+            return static_cast<Uint8>(hue < 0 ? hue + 256 : hue);
+        }
+        case SaturationKey: {
+            int high = max(red, max(green, blue));
+            int low = min(red, min(green, blue));
+            return high == 0 ? 0 : static_cast<Uint8>((high - low) * 255 / high);
+        }
+        case RedKey:
+            return channels[0];
+        case GreenKey:
+            return channels[1];
+        case BlueKey:
+            return channels[2];
+        default:
+            return 0;
+    }
+}
+
+const char* getSortBackendName(SortBackend backend)
+{
+    static const char* names[SortBackendCount] = {"insertion", "network", "std::sort", "radix"};
+    return backend >= 0 && backend < SortBackendCount ? names[backend] : "";
+}
+
+bool sortBackendFromName(const string& name, SortBackend& backend)
+{
+    for (int i = 0; i < SortBackendCount; ++i) {
+        if (name == getSortBackendName(static_cast<SortBackend>(i))) {
+            backend = static_cast<SortBackend>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+SortDispatch::SortDispatch()
+{
+    fill(backends, backends + SegmentStats::HistogramBuckets, StdSortBackend);
+}
+
+const SortDispatch& getSortDispatch()
+{
+    return activeDispatch;
+}
+
+void setSortDispatch(const SortDispatch& dispatch)
+{
+    activeDispatch = dispatch;
+}
+
+void sortPixels(Uint32* pixels, size_t count, vector<Uint32>& scratch, SortBackend backend)
+{
+    if (count < 2)
+        return;
+
+    switch (backend) {
+        case InsertionSortBackend:
+            insertionSort(pixels, count);
+            break;
+        case NetworkSortBackend:
+            if (count <= NetworkSize) {
+                networkSort(pixels, count);
+            } else {
+                sort(pixels, pixels + count);
+            }
+            break;
+        case RadixSortBackend:
+            radixSort(pixels, count, scratch);
+            break;
+        default:
+            sort(pixels, pixels + count);
+            break;
+    }
+}
+
+void sortPixels(Uint32* pixels, size_t count, vector<Uint32>& scratch)
+{
+    if (count < 2)
+        return;
+    sortPixels(pixels, count, scratch, activeDispatch.backends[SegmentStats::getBucket(count)]);
+}
+
+void sortPixelsByKey(Uint32* pixels, size_t count, SortKey key, vector<Uint64>& records, vector<Uint64>& scratch)
+{
+    if (count < 2)
+        return;
+
+    if (records.size() < count)
+        records.resize(count);
+
+    // The key goes above the pixel, so that records compare by key first
+    for (size_t i = 0; i < count; ++i)
+        records[i] = (static_cast<Uint64>(getKey(pixels[i], key)) << 32) | pixels[i];
+
+    // Networks only take 32 bit pixels, radix sorts only go over the 5
+    // bytes in use
+    Uint64* first = &records[0];
+    switch (activeDispatch.backends[SegmentStats::getBucket(count)]) {
+        case InsertionSortBackend:
+        case NetworkSortBackend:
+            insertionSort(first, count);
+            break;
+        case RadixSortBackend:
+            radixSort(first, count, scratch, 5);
+            break;
+        default:
+            sort(first, first + count);
+            break;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        pixels[i] = static_cast<Uint32>(records[i]);
+}
+
+SortDispatch calibrateSortDispatch()
+{
+    SortDispatch dispatch;
+
+    // xorshift, rand() drives the random walks and must not move
+    Uint32 state = 2463534242u;
+    vector<Uint32> input(CalibrationPixels);
+    for (Uint32& pixel : input) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        pixel = 0xFF000000 | (state & 0xFFFFFF);
+    }
+
+    vector<Uint32> work(CalibrationPixels);
+    vector<Uint32> scratch;
+
+    for (int bucket = 0; bucket < SegmentStats::HistogramBuckets; ++bucket) {
+        // The middle of the bucket, the last one stands for longer segments
+        size_t length = max<size_t>(2, (size_t(1) << bucket) + (size_t(1) << bucket) / 2);
+        size_t segments = max<size_t>(1, CalibrationPixels / length);
+        double bestTime = 0;
+
+        for (int backend = 0; backend < SortBackendCount; ++backend) {
+            if (backend == NetworkSortBackend && length > NetworkSize)
+                continue;
+
+            double time = 0;
+            for (int trial = 0; trial < CalibrationTrials; ++trial) {
+                copy(input.begin(), input.end(), work.begin());
+
+                auto start = chrono::steady_clock::now();
+                for (size_t segment = 0; segment < segments; ++segment)
+                    sortPixels(&work[segment * length], length, scratch, static_cast<SortBackend>(backend));
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                time = trial == 0 ? elapsed : min(time, elapsed);
+            }
+
+            if (backend == 0 || time < bestTime) {
+                bestTime = time;
+                dispatch.backends[bucket] = static_cast<SortBackend>(backend);
+            }
+        }
+    }
+    return dispatch;
+}
+
+bool saveSortDispatch(const SortDispatch& dispatch, const string& path)
+{
+    ofstream output(path.c_str());
+    output << "# fakeartist sort dispatch, one line per segment length bucket:" << endl
+           << "# <bucket> <backend>, bucket i holding segments of 2^i to 2^(i+1) - 1 pixels" << endl;
+    for (int bucket = 0; bucket < SegmentStats::HistogramBuckets; ++bucket)
+        output << bucket << " " << getSortBackendName(dispatch.backends[bucket]) << endl;
+
+    output.close();
+    if (!output) {
+        cerr << "Could not write the sort dispatch to " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadSortDispatch(const string& path, SortDispatch& dispatch)
+{
+    ifstream input(path.c_str());
+    if (!input)
+        return false;
+
+    SortDispatch loaded;
+    string line;
+    while (getline(input, line)) {
+        line = line.substr(0, line.find('#'));
+        istringstream stream(line);
+        int bucket;
+        string name;
+        if (!(stream >> bucket))
+            continue;
+
+        SortBackend backend;
+        if (!(stream >> name) || bucket < 0 || bucket >= SegmentStats::HistogramBuckets || !sortBackendFromName(name, backend)) {
+            cerr << path << " is not a sort dispatch" << endl;
+            return false;
+        }
+        loaded.backends[bucket] = backend;
+    }
+
+    dispatch = loaded;
+    return true;
+}
+
+bool useSortDispatch(const string& path, bool recalibrate)
+{
+    SortDispatch dispatch;
+    if (!recalibrate && loadSortDispatch(path, dispatch)) {
+        setSortDispatch(dispatch);
+        return true;
+    }
+
+    // On stderr, fakeartist-render --pipe writes frames to stdout
+    cerr << "Calibrating the sorts..." << endl;
+    dispatch = calibrateSortDispatch();
+    setSortDispatch(dispatch);
+
+    for (int bucket = 0; bucket < SegmentStats::HistogramBuckets; ++bucket)
+        cerr << "  from " << (1 << bucket) << " pixels: " << getSortBackendName(dispatch.backends[bucket]) << endl;
+
+    return saveSortDispatch(dispatch, path);
+}
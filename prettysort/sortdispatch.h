@@ -0,0 +1,66 @@
+#ifndef sortdispatch_
+#define sortdispatch_
+
+#include <string>
+#include <vector>
+
+#include "prettysort.h"
+
+// The sorts the kernels can hand a segment to. They all sort the pixels as
+// plain 32 bit integers, so they all give the same frame and only differ in
+// speed, which depends on the length of the segment and on the CPU.
+enum SortBackend
+{
+    InsertionSortBackend,
+    NetworkSortBackend,     // Batcher's odd-even merge network, segments of up to 32 pixels
+    StdSortBackend,
+    RadixSortBackend,       // LSD, a byte at a time, skipping the bytes all pixels share
+    SortBackendCount
+};
+
+const char* getSortBackendName(SortBackend backend);
+bool sortBackendFromName(const string& name, SortBackend& backend);
+
+// Which backend sorts the segments of each length, by the same power of
+// two buckets as SegmentStats::lengthHistogram. The default table uses
+// std::sort everywhere, like the sorter always did.
+struct SortDispatch
+{
+    SortDispatch();
+
+    SortBackend backends[SegmentStats::HistogramBuckets];
+};
+
+// The table the kernels use. Meant to be set once at startup, not while
+// frames are being sorted.
+const SortDispatch& getSortDispatch();
+void setSortDispatch(const SortDispatch& dispatch);
+
+// Time every backend on this machine, on segments of every bucket filled
+// with random opaque pixels, and return the fastest for each. Takes a few
+// hundred milliseconds. Leaves rand() alone.
+SortDispatch calibrateSortDispatch();
+
+// One "bucket backend" line per bucket, with a comment header.
+bool saveSortDispatch(const SortDispatch& dispatch, const string& path);
+bool loadSortDispatch(const string& path, SortDispatch& dispatch);
+
+// Use the table saved at path, or calibrate one and save it there when
+// there is none yet, so that only the first run pays for the calibration.
+// With recalibrate, the saved table is replaced. Returns false if the
+// table could not be saved, it is used all the same.
+bool useSortDispatch(const string& path, bool recalibrate = false);
+
+// Sort count pixels in place with the backend the table gives for count,
+// scratch is working memory that the caller keeps between calls.
+void sortPixels(Uint32* pixels, size_t count, vector<Uint32>& scratch);
+void sortPixels(Uint32* pixels, size_t count, vector<Uint32>& scratch, SortBackend backend);
+
+// Sort count pixels in place by key, then by raw value. The keys are packed
+// above the pixels into 64 bit records, which are sorted with the backend
+// the table gives for count: one comparison of records compares keys
+// without computing them again. Radix sorts take 4 counting passes over the
+// pixel, at most, and one over the 8 bit key.
+void sortPixelsByKey(Uint32* pixels, size_t count, SortKey key, vector<Uint64>& records, vector<Uint64>& scratch);
+
+#endif
@@ -0,0 +1,243 @@
+//
+//  ChunkedRender.cpp
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+#include "ChunkedRender.h"
+#include "Demuxer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+using namespace std;
+using namespace sf;
+
+bool splitAtKeyframes(const string& path, unsigned count, vector<Chunk>& chunks)
+{
+    sfe::Demuxer::loadFFmpeg();
+
+    AVFormatContext* formatContext = nullptr;
+    if (avformat_open_input(&formatContext, path.c_str(), nullptr, nullptr) < 0) {
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+
+    int streamIndex = -1;
+    if (avformat_find_stream_info(formatContext, nullptr) >= 0)
+        streamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) {
+        cerr << "No video stream in " << path << endl;
+        avformat_close_input(&formatContext);
+        return false;
+    }
+
+    AVStream* stream = formatContext->streams[streamIndex];
+    int64_t startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+
+    vector<Int64> keyframes;
+    Int64 duration = 0;
+
+    AVPacket packet;
+    while (av_read_frame(formatContext, &packet) >= 0) {
+        if (packet.stream_index == streamIndex) {
+            int64_t timestamp = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+            if (timestamp != AV_NOPTS_VALUE) {
+                // Same computation as VideoStream::decodePacket(), so that
+                // workers can compare these with decoded frame timestamps
+                Int64 ms = 1000 * (timestamp - startTime) * av_q2d(stream->time_base);
+                if (packet.flags & AV_PKT_FLAG_KEY)
+                    keyframes.push_back(ms);
+                duration = max(duration, ms);
+            }
+        }
+        av_free_packet(&packet);
+    }
+    avformat_close_input(&formatContext);
+
+    sort(keyframes.begin(), keyframes.end());
+
+    chunks.clear();
+    Int64 start = 0;
+    for (unsigned i = 1; i < count; ++i) {
+        Int64 target = max(duration * i / count, start + 1);
+        vector<Int64>::const_iterator keyframe = lower_bound(keyframes.begin(), keyframes.end(), target);
+        if (keyframe == keyframes.end())
+            break;
+
+        Chunk chunk = {start, *keyframe};
+        chunks.push_back(chunk);
+        start = *keyframe;
+    }
+
+    Chunk last = {start, -1};
+    chunks.push_back(last);
+    return true;
+}
+
+bool runProcesses(const vector<vector<string>>& commands)
+{
+    vector<pid_t> processes;
+    bool ok = true;
+
+    for (size_t i = 0; i < commands.size(); ++i) {
+        vector<char*> arguments;
+        for (size_t j = 0; j < commands[i].size(); ++j)
+            arguments.push_back(const_cast<char*>(commands[i][j].c_str()));
+        arguments.push_back(nullptr);
+
+        pid_t process;
+        if (posix_spawnp(&process, arguments[0], nullptr, nullptr, &arguments[0], environ) != 0) {
+            cerr << "Could not start " << arguments[0] << endl;
+            ok = false;
+            break;
+        }
+        processes.push_back(process);
+    }
+
+    for (size_t i = 0; i < processes.size(); ++i) {
+        int status = 0;
+        if (waitpid(processes[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            cerr << "Worker " << i << " failed" << endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+// Opens the output file with the streams and encoding parameters of the first part
+static bool openOutput(AVFormatContext*& outputContext, const string& output, AVFormatContext* inputContext)
+{
+    avformat_alloc_output_context2(&outputContext, nullptr, nullptr, output.c_str());
+    if (!outputContext) {
+        cerr << "Unknown video format for " << output << endl;
+        return false;
+    }
+
+    for (unsigned i = 0; i < inputContext->nb_streams; ++i) {
+        AVStream* inputStream = inputContext->streams[i];
+        AVStream* outputStream = avformat_new_stream(outputContext, nullptr);
+        if (!outputStream || avcodec_copy_context(outputStream->codec, inputStream->codec) < 0) {
+            cerr << "Could not create the streams of " << output << endl;
+            return false;
+        }
+        outputStream->codec->codec_tag = 0;
+        outputStream->time_base = inputStream->time_base;
+        if (outputContext->oformat->flags & AVFMT_GLOBALHEADER)
+            outputStream->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+    }
+
+    if (!(outputContext->oformat->flags & AVFMT_NOFILE) && avio_open(&outputContext->pb, output.c_str(), AVIO_FLAG_WRITE) < 0) {
+        cerr << "Could not open " << output << " for writing" << endl;
+        return false;
+    }
+
+    if (avformat_write_header(outputContext, nullptr) < 0) {
+        cerr << "Could not write the header of " << output << endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool concatenateVideos(const vector<string>& parts, const string& output)
+{
+    sfe::Demuxer::loadFFmpeg();
+
+    AVFormatContext* outputContext = nullptr;
+    bool headerWritten = false;
+    bool ok = true;
+
+    // End of the previous part, in AV_TIME_BASE units
+    int64_t lastDts = AV_NOPTS_VALUE;
+
+    for (size_t i = 0; ok && i < parts.size(); ++i) {
+        AVFormatContext* inputContext = nullptr;
+        if (avformat_open_input(&inputContext, parts[i].c_str(), nullptr, nullptr) < 0) {
+            cerr << "Could not open " << parts[i] << endl;
+            ok = false;
+            break;
+        }
+
+        int videoIndex = -1;
+        if (avformat_find_stream_info(inputContext, nullptr) >= 0)
+            videoIndex = av_find_best_stream(inputContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (videoIndex < 0 || (headerWritten && inputContext->nb_streams != outputContext->nb_streams)) {
+            cerr << parts[i] << " doesn't have the streams of the other parts" << endl;
+            avformat_close_input(&inputContext);
+            ok = false;
+            break;
+        }
+
+        if (!headerWritten) {
+            headerWritten = openOutput(outputContext, output, inputContext);
+            if (!headerWritten) {
+                avformat_close_input(&inputContext);
+                ok = false;
+                break;
+            }
+        }
+
+        // Parts keep the timestamps of the source movie, they are only
+        // shifted if the encoder delay makes their video overlap the
+        // previous part. Every stream of a part moves together.
+        int64_t shift = 0;
+        bool firstVideoPacket = true;
+
+        AVPacket packet;
+        while (ok && av_read_frame(inputContext, &packet) >= 0) {
+            AVStream* inputStream = inputContext->streams[packet.stream_index];
+            AVStream* outputStream = outputContext->streams[packet.stream_index];
+
+            if (packet.stream_index == videoIndex && packet.dts != AV_NOPTS_VALUE) {
+                int64_t dts = av_rescale_q(packet.dts, inputStream->time_base, AV_TIME_BASE_Q);
+                if (firstVideoPacket && lastDts != AV_NOPTS_VALUE && dts + shift <= lastDts)
+                    shift = lastDts + 1 - dts;
+                firstVideoPacket = false;
+                lastDts = dts + shift;
+            }
+
+            int64_t packetShift = av_rescale_q(shift, AV_TIME_BASE_Q, inputStream->time_base);
+            if (packet.pts != AV_NOPTS_VALUE)
+                packet.pts = av_rescale_q(packet.pts + packetShift, inputStream->time_base, outputStream->time_base);
+            if (packet.dts != AV_NOPTS_VALUE)
+                packet.dts = av_rescale_q(packet.dts + packetShift, inputStream->time_base, outputStream->time_base);
+            packet.duration = static_cast<int>(av_rescale_q(packet.duration, inputStream->time_base, outputStream->time_base));
+            packet.pos = -1;
+
+            if (av_interleaved_write_frame(outputContext, &packet) < 0) {
+                cerr << "Error while writing a frame of " << output << endl;
+                ok = false;
+            }
+            av_free_packet(&packet);
+        }
+
+        avformat_close_input(&inputContext);
+    }
+
+    if (headerWritten && av_write_trailer(outputContext) < 0) {
+        cerr << "Could not finish writing " << output << endl;
+        ok = false;
+    }
+
+    if (outputContext) {
+        if (!(outputContext->oformat->flags & AVFMT_NOFILE) && outputContext->pb)
+            avio_closep(&outputContext->pb);
+        avformat_free_context(outputContext);
+    }
+
+    return ok;
+}
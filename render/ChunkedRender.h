@@ -0,0 +1,41 @@
+//
+//  ChunkedRender.h
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef render_ChunkedRender_h
+#define render_ChunkedRender_h
+
+#include <string>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+// Helpers to render a long movie with several processes: the movie is split
+// at keyframes, every chunk is rendered to its own file by a worker process
+// and the files are joined back without re-encoding.
+
+// Part of a movie, in milliseconds relative to its first video frame, with
+// the same rounding as the frame timestamps of sfe::VideoStream. Chunks
+// start on a keyframe; the last one has an end of -1.
+struct Chunk
+{
+    sf::Int64 start;
+    sf::Int64 end;
+};
+
+// Split the video stream of a movie into at most count chunks of about the
+// same duration. Only packets are read, nothing is decoded.
+bool splitAtKeyframes(const std::string& path, unsigned count, std::vector<Chunk>& chunks);
+
+// Start one process per command line, the first argument being the program,
+// and wait for all of them. Returns false if any of them failed.
+bool runProcesses(const std::vector<std::vector<std::string>>& commands);
+
+// Join files with the same streams, encoded with the same settings, into one
+// file, copying packets as they are.
+bool concatenateVideos(const std::vector<std::string>& parts, const std::string& output);
+
+#endif
@@ -0,0 +1,239 @@
+//
+//  FramePipe.cpp
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "FramePipe.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "prettysort.h"
+
+using namespace std;
+using namespace sf;
+
+// Enough for a few 1080p rgba frames to move in one system call
+static const size_t StreamBufferSize = 1 << 20;
+
+// stdio uses the buffers of a stream until it is closed, which for stdin
+// and stdout is at exit, so they can't belong to a FramePipe
+static char inputStreamBuffer[StreamBufferSize];
+static char outputStreamBuffer[StreamBufferSize];
+
+static inline Uint8 clampComponent(int value)
+{
+    return static_cast<Uint8>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+FramePipe::FramePipe(Format format_, FILE* input_, FILE* output_)
+    : format(format_)
+    , input(input_)
+    , output(output_)
+    , frameRate(30)
+    , frameCount(0)
+    , subsampled(false)
+{
+    setvbuf(input, inputStreamBuffer, _IOFBF, sizeof(inputStreamBuffer));
+    setvbuf(output, outputStreamBuffer, _IOFBF, sizeof(outputStreamBuffer));
+}
+
+bool FramePipe::open(const Vector2u& size_, float frameRate_)
+{
+    frameCount = 0;
+
+    if (format == Rgba) {
+        size = size_;
+        frameRate = frameRate_;
+    } else if (!readHeader()) {
+        return false;
+    } else if (fwrite(header.data(), 1, header.size(), output) != header.size()) {
+        return false;
+    }
+
+    if (size.x == 0 || size.y == 0 || frameRate <= 0) {
+        cerr << "Invalid frame size or rate" << endl;
+        return false;
+    }
+
+    if (format == Y4m) {
+        size_t chroma = subsampled ? ((size.x + 1) / 2) * ((size.y + 1) / 2) : size.x * size.y;
+        yuv.resize(size.x * size.y + 2 * chroma);
+    }
+    return true;
+}
+
+// YUV4MPEG2 W640 H360 F30000:1001 Ip A1:1 C420jpeg
+bool FramePipe::readHeader()
+{
+    header.clear();
+    int c;
+    while ((c = fgetc(input)) != EOF && c != '\n')
+        header += static_cast<char>(c);
+    if (c != '\n' || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        cerr << "Input is not a Y4M stream" << endl;
+        return false;
+    }
+    header += '\n';
+
+    string colorspace = "420";
+    istringstream parameters(header.substr(10));
+    string parameter;
+    while (parameters >> parameter) {
+        switch (parameter[0]) {
+            case 'W':
+                size.x = atoi(parameter.c_str() + 1);
+                break;
+            case 'H':
+                size.y = atoi(parameter.c_str() + 1);
+                break;
+            case 'F': {
+                int numerator = 0, denominator = 0;
+                if (sscanf(parameter.c_str() + 1, "%d:%d", &numerator, &denominator) == 2 && denominator > 0)
+                    frameRate = static_cast<float>(numerator) / denominator;
+                break;
+            }
+            case 'C':
+                colorspace = parameter.substr(1);
+                break;
+        }
+    }
+
+    // C420jpeg, C420paldv and C420mpeg2 only differ by chroma siting, the
+    // deeper C420p10 and the like don't have 8 bit samples
+    if (colorspace == "420" || colorspace == "420jpeg" || colorspace == "420mpeg2" || colorspace == "420paldv") {
+        subsampled = true;
+    } else if (colorspace == "444") {
+        subsampled = false;
+    } else {
+        cerr << "Unsupported Y4M colorspace " << colorspace << endl;
+        return false;
+    }
+    return true;
+}
+
+bool FramePipe::read(Image& image)
+{
+    Uint8* pixels = reinterpret_cast<Uint8*>(getWritablePixels(image));
+
+    if (format == Rgba) {
+        size_t length = size.x * size.y * 4;
+        if (fread(pixels, 1, length, input) != length)
+            return false;
+    } else {
+        // FRAME followed by optional parameters
+        int c;
+        string tag;
+        while ((c = fgetc(input)) != EOF && c != '\n') {
+            if (tag.size() < 5)
+                tag += static_cast<char>(c);
+        }
+        if (c != '\n' || tag != "FRAME")
+            return false;
+
+        if (fread(&yuv[0], 1, yuv.size(), input) != yuv.size())
+            return false;
+        yuvToRgba(pixels);
+    }
+
+    frameCount++;
+    return true;
+}
+
+bool FramePipe::write(const Image& image)
+{
+    const Uint8* pixels = image.getPixelsPtr();
+
+    if (format == Rgba) {
+        size_t length = size.x * size.y * 4;
+        return fwrite(pixels, 1, length, output) == length;
+    }
+
+    rgbaToYuv(pixels);
+    static const char frameHeader[] = "FRAME\n";
+    return fwrite(frameHeader, 1, sizeof(frameHeader) - 1, output) == sizeof(frameHeader) - 1
+        && fwrite(&yuv[0], 1, yuv.size(), output) == yuv.size();
+}
+
+Vector2u FramePipe::getSize() const
+{
+    return size;
+}
+
+Time FramePipe::getTimestamp() const
+{
+    return seconds((frameCount - 1) / frameRate);
+}
+
+void FramePipe::createImage(Image& image) const
+{
+    image.create(size.x, size.y);
+}
+
+void FramePipe::yuvToRgba(Uint8* rgba) const
+{
+    unsigned chromaWidth = subsampled ? (size.x + 1) / 2 : size.x;
+    unsigned chromaHeight = subsampled ? (size.y + 1) / 2 : size.y;
+    const Uint8* yPlane = &yuv[0];
+    const Uint8* uPlane = yPlane + size.x * size.y;
+    const Uint8* vPlane = uPlane + chromaWidth * chromaHeight;
+
+    for (unsigned y = 0; y < size.y; ++y) {
+        const Uint8* lumaRow = yPlane + y * size.x;
+        unsigned chromaRow = (subsampled ? y / 2 : y) * chromaWidth;
+
+        for (unsigned x = 0; x < size.x; ++x) {
+            unsigned chroma = chromaRow + (subsampled ? x / 2 : x);
+            int c = 298 * (lumaRow[x] - 16);
+            int d = uPlane[chroma] - 128;
+            int e = vPlane[chroma] - 128;
+
+            rgba[0] = clampComponent((c + 409 * e + 128) >> 8);
+            rgba[1] = clampComponent((c - 100 * d - 208 * e + 128) >> 8);
+            rgba[2] = clampComponent((c + 516 * d + 128) >> 8);
+            rgba[3] = 255;
+            rgba += 4;
+        }
+    }
+}
+
+void FramePipe::rgbaToYuv(const Uint8* rgba)
+{
+    unsigned chromaWidth = subsampled ? (size.x + 1) / 2 : size.x;
+    unsigned chromaHeight = subsampled ? (size.y + 1) / 2 : size.y;
+    Uint8* yPlane = &yuv[0];
+    Uint8* uPlane = yPlane + size.x * size.y;
+    Uint8* vPlane = uPlane + chromaWidth * chromaHeight;
+
+    for (unsigned i = 0; i < size.x * size.y; ++i) {
+        const Uint8* pixel = rgba + i * 4;
+        yPlane[i] = static_cast<Uint8>(((66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128) >> 8) + 16);
+    }
+
+    // Chroma is computed from the average color of each block it covers
+    unsigned block = subsampled ? 2 : 1;
+    for (unsigned cy = 0; cy < chromaHeight; ++cy) {
+        for (unsigned cx = 0; cx < chromaWidth; ++cx) {
+            int r = 0, g = 0, b = 0, count = 0;
+            for (unsigned y = cy * block; y < min(cy * block + block, size.y); ++y) {
+                for (unsigned x = cx * block; x < min(cx * block + block, size.x); ++x) {
+                    const Uint8* pixel = rgba + (y * size.x + x) * 4;
+                    r += pixel[0];
+                    g += pixel[1];
+                    b += pixel[2];
+                    count++;
+                }
+            }
+            r /= count;
+            g /= count;
+            b /= count;
+
+            unsigned chroma = cy * chromaWidth + cx;
+            uPlane[chroma] = clampComponent(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vPlane[chroma] = clampComponent(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
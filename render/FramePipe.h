@@ -0,0 +1,77 @@
+//
+//  FramePipe.h
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef render_FramePipe_h
+#define render_FramePipe_h
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <SFML/Graphics.hpp>
+
+// Reads raw video frames from a stream and writes frames back in the same
+// format, so that the sorter can sit in a shell pipeline:
+//
+//     ffmpeg -i in.mp4 -f yuv4mpegpipe - | fakeartist-render --pipe y4m |
+//         ffmpeg -f yuv4mpegpipe -i - out.mp4
+//
+// Rgba frames are width * height * 4 bytes with no header, the size and
+// frame rate are given by the caller. Y4m streams describe themselves; 8 bit
+// 4:2:0 and 4:4:4 streams are supported, converted to RGBA with BT.601 limited
+// range coefficients and back, and the stream header is written unchanged.
+//
+// Buffers are allocated once by open(), reading and writing frames doesn't
+// allocate anything.
+class FramePipe
+{
+public:
+    enum Format
+    {
+        Rgba,
+        Y4m
+    };
+
+    FramePipe(Format format, FILE* input, FILE* output);
+
+    // Read the stream header if there's one and prepare the buffers. size
+    // and frameRate are only used for rgba streams.
+    bool open(const sf::Vector2u& size = sf::Vector2u(), float frameRate = 30);
+
+    // Read the next frame into image, which open() sized already. Returns
+    // false at the end of the input or on a malformed frame.
+    bool read(sf::Image& image);
+
+    bool write(const sf::Image& image);
+
+    sf::Vector2u getSize() const;
+
+    // Time of the last frame read, from the frame rate.
+    sf::Time getTimestamp() const;
+
+    // Create an image of the right size to read frames into.
+    void createImage(sf::Image& image) const;
+
+private:
+    bool readHeader();
+    void yuvToRgba(sf::Uint8* rgba) const;
+    void rgbaToYuv(const sf::Uint8* rgba);
+
+    Format format;
+    FILE* input;
+    FILE* output;
+
+    sf::Vector2u size;
+    float frameRate;
+    long frameCount;
+
+    std::string header;
+    bool subsampled;
+    std::vector<sf::Uint8> yuv;
+};
+
+#endif
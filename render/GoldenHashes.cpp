@@ -0,0 +1,136 @@
+//
+//  GoldenHashes.cpp
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "GoldenHashes.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace sf;
+
+static const Uint64 FnvOffset = 14695981039346656037ULL;
+static const Uint64 FnvPrime = 1099511628211ULL;
+
+// Only the first mismatches are printed, a broken sorter fails every frame
+static const long ReportedMismatches = 10;
+
+static Uint64 fnv1a(Uint64 hash, const Uint8* bytes, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+GoldenHashes::GoldenHashes()
+    : mode(Off)
+    , frameCount(0)
+    , mismatchCount(0)
+{
+}
+
+bool GoldenHashes::open(Mode mode_, const string& path_)
+{
+    mode = mode_;
+    path = path_;
+    frameCount = 0;
+    mismatchCount = 0;
+    expected.clear();
+
+    if (mode == Write) {
+        output.open(path.c_str());
+        if (!output) {
+            cerr << "Could not write " << path << endl;
+            mode = Off;
+            return false;
+        }
+        output << "# frame hash" << endl;
+    } else if (mode == Check) {
+        ifstream input(path.c_str());
+        if (!input) {
+            cerr << "Could not open " << path << endl;
+            mode = Off;
+            return false;
+        }
+
+        string line;
+        while (getline(input, line)) {
+            line = line.substr(0, line.find('#'));
+            istringstream stream(line);
+            long index;
+            string hex;
+            if (!(stream >> index >> hex))
+                continue;
+            expected.push_back(strtoull(hex.c_str(), nullptr, 16));
+        }
+    }
+    return true;
+}
+
+bool GoldenHashes::isOpen() const
+{
+    return mode != Off;
+}
+
+void GoldenHashes::add(const Uint8* pixels, const Vector2u& size)
+{
+    if (mode == Off)
+        return;
+
+    Uint64 value = hash(pixels, size);
+    if (mode == Write) {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(value));
+        output << frameCount << " " << hex << "\n";
+    } else if (frameCount < static_cast<long>(expected.size()) && expected[frameCount] != value) {
+        if (mismatchCount < ReportedMismatches)
+            cerr << "Frame " << frameCount << " differs from " << path << endl;
+        mismatchCount++;
+    }
+    frameCount++;
+}
+
+bool GoldenHashes::finish()
+{
+    if (mode == Write) {
+        output.close();
+        if (!output) {
+            cerr << "Could not write " << path << endl;
+            return false;
+        }
+        cout << "Wrote the hashes of " << frameCount << " frames to " << path << endl;
+        return true;
+    }
+    if (mode != Check)
+        return true;
+
+    bool ok = mismatchCount == 0 && frameCount == static_cast<long>(expected.size());
+    if (frameCount != static_cast<long>(expected.size()))
+        cerr << "Rendered " << frameCount << " frames, " << path << " has " << expected.size() << endl;
+    if (ok) {
+        cout << "All " << frameCount << " frames match " << path << endl;
+    } else if (mismatchCount > 0) {
+        cerr << mismatchCount << " frames differ from " << path << endl;
+    }
+    return ok;
+}
+
+Uint64 GoldenHashes::hash(const Uint8* pixels, const Vector2u& size)
+{
+    Uint8 header[8];
+    for (int i = 0; i < 4; ++i) {
+        header[i] = static_cast<Uint8>((size.x >> (8 * i)) & 0xFF);
+        header[4 + i] = static_cast<Uint8>((size.y >> (8 * i)) & 0xFF);
+    }
+
+    Uint64 value = fnv1a(FnvOffset, header, sizeof(header));
+    return fnv1a(value, pixels, static_cast<size_t>(size.x) * size.y * 4);
+}
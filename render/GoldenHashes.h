@@ -0,0 +1,58 @@
+//
+//  GoldenHashes.h
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef render_GoldenHashes_h
+#define render_GoldenHashes_h
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <SFML/System.hpp>
+
+// Hashes of the sorted frames of a render, for checking that a change of
+// the sorter leaves its output alone. --write-golden saves one line per
+// frame, its index and a 64 bit FNV-1a hash of its size and pixels in hex;
+// --check-golden compares a render against such a file.
+//
+// Random walks come from rand(), whose sequence differs between C
+// libraries, so goldens with random walks only hold on the platform that
+// wrote them.
+class GoldenHashes
+{
+public:
+    enum Mode
+    {
+        Off,
+        Write,
+        Check
+    };
+
+    GoldenHashes();
+
+    bool open(Mode mode, const std::string& path);
+    bool isOpen() const;
+
+    // Hashes the next frame, tightly packed RGBA, and writes or checks it
+    void add(const sf::Uint8* pixels, const sf::Vector2u& size);
+
+    // Reports the outcome; false if a frame didn't match or the frame
+    // counts differ
+    bool finish();
+
+    static sf::Uint64 hash(const sf::Uint8* pixels, const sf::Vector2u& size);
+
+private:
+    Mode mode;
+    std::string path;
+    std::ofstream output;
+    std::vector<sf::Uint64> expected;
+    long frameCount;
+    long mismatchCount;
+};
+
+#endif
@@ -0,0 +1,162 @@
+//
+//  StateScript.cpp
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#include "StateScript.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+static const char* const toggleNames[] = {"diagonals", "cols", "rows", "circles", "spirals", "random"};
+static const char* const axisNames[] = {"mouseX", "mouseY"};
+
+static bool isKnownSetting(const string& name)
+{
+    for (const char* toggle : toggleNames) {
+        if (name == toggle)
+            return true;
+    }
+    for (const char* axis : axisNames) {
+        if (name == axis)
+            return true;
+    }
+    return name == "key";
+}
+
+StateScript::StateScript()
+{
+}
+
+bool StateScript::loadFromFile(const string& path)
+{
+    ifstream file(path.c_str());
+    if (!file) {
+        cerr << "Could not open script " << path << endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        istringstream stream(line);
+        float time;
+        if (!(stream >> time))
+            continue;
+
+        string settings;
+        getline(stream, settings);
+        if (!addKeyframe(time, settings)) {
+            cerr << path << ":" << lineNumber << ": invalid keyframe" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StateScript::addKeyframe(float time, const string& settings)
+{
+    Keyframe keyframe;
+    keyframe.time = time;
+
+    istringstream stream(settings);
+    string setting;
+    while (stream >> setting) {
+        size_t equal = setting.find('=');
+        if (equal == string::npos)
+            return false;
+
+        string name = setting.substr(0, equal);
+        if (!isKnownSetting(name)) {
+            cerr << "Unknown setting " << name << endl;
+            return false;
+        }
+
+        // Sort keys are kept by their index, like toggles are kept as 0 or 1
+        if (name == "key") {
+            SortKey key;
+            if (!sortKeyFromName(setting.substr(equal + 1), key)) {
+                cerr << "Unknown sort key " << setting.substr(equal + 1) << endl;
+                return false;
+            }
+            keyframe.values[name] = key;
+            continue;
+        }
+
+        istringstream valueStream(setting.substr(equal + 1));
+        float value;
+        if (!(valueStream >> value))
+            return false;
+        keyframe.values[name] = value;
+    }
+
+    // Keep keyframes sorted, a later keyframe at the same time wins
+    auto position = upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const Keyframe& k) {
+        return t < k.time;
+    });
+    keyframes.insert(position, keyframe);
+    return true;
+}
+
+bool StateScript::lookup(const string& name, float time, float& value, bool interpolate) const
+{
+    const Keyframe* before = nullptr;
+    const Keyframe* after = nullptr;
+
+    for (const Keyframe& keyframe : keyframes) {
+        if (!keyframe.values.count(name))
+            continue;
+        if (keyframe.time <= time) {
+            before = &keyframe;
+        } else {
+            after = &keyframe;
+            break;
+        }
+    }
+
+    if (!before && !after)
+        return false;
+
+    if (!before) {
+        value = after->values.at(name);
+    } else if (!after || !interpolate) {
+        value = before->values.at(name);
+    } else {
+        float a = before->values.at(name), b = after->values.at(name);
+        float t = (time - before->time) / (after->time - before->time);
+        value = a + (b - a) * t;
+    }
+    return true;
+}
+
+State StateScript::stateAt(float time) const
+{
+    State state;
+    state.mouseX = 0.5f;
+    state.mouseY = 0.5f;
+    state.time = time;
+
+    bool* toggles[] = {&state.diagonals, &state.cols, &state.rows, &state.circles, &state.spirals, &state.random};
+    for (size_t i = 0; i < 6; ++i) {
+        float value;
+        if (lookup(toggleNames[i], time, value, false))
+            *toggles[i] = value != 0;
+    }
+
+    lookup("mouseX", time, state.mouseX, true);
+    lookup("mouseY", time, state.mouseY, true);
+
+    float key;
+    if (lookup("key", time, key, false))
+        state.key = static_cast<SortKey>(static_cast<int>(key));
+    return state;
+}
@@ -0,0 +1,57 @@
+//
+//  StateScript.h
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+#ifndef render_StateScript_h
+#define render_StateScript_h
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "prettysort.h"
+
+// Sorting state over time, for rendering without a mouse and keyboard.
+//
+// A script is a list of keyframes, one per line: a time in seconds followed
+// by the settings that change at that time, like
+//
+//     # seconds  settings
+//     0          diagonals=1 mouseX=0.2 mouseY=0.5
+//     4.5        mouseX=0.8
+//     10         rows=1 diagonals=0
+//
+// Toggles (diagonals, cols, rows, circles, spirals, random) take effect at
+// their keyframe; mouseX and mouseY are interpolated between keyframes. key
+// takes the name of a sort key (raw, luma, hue, saturation, red, green,
+// blue), see prettysort.h, and takes effect at its keyframe too.
+class StateScript
+{
+public:
+    StateScript();
+
+    bool loadFromFile(const std::string& path);
+
+    // Add a keyframe from its settings ("rows=1 mouseX=0.4"), returns false
+    // if a setting is invalid.
+    bool addKeyframe(float time, const std::string& settings);
+
+    // State at the given time, in seconds.
+    State stateAt(float time) const;
+
+private:
+    struct Keyframe
+    {
+        float time;
+        std::map<std::string, float> values;
+    };
+
+    bool lookup(const std::string& name, float time, float& value, bool interpolate) const;
+
+    std::vector<Keyframe> keyframes;
+};
+
+#endif
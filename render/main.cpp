@@ -0,0 +1,682 @@
+//
+//  main.cpp
+//  render
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+// Headless renderer: sorts every frame of a movie and records the result,
+// as fast as the machine allows. Frames are stepped through one by one with
+// sfeMovie's demuxer, and never touch a texture or a window, so this runs
+// fine on a box without any display.
+//
+//     fakeartist-render input.mp4 --record output.mp4 [--script state.txt]
+//                       [--state "rows=1 mouseX=0.3"] [--frames N] [--seed N]
+//                       [--jobs N] [--no-audio]
+//
+// The soundtrack of the movie is copied to video outputs as it is, packets go
+// straight from the demuxer to the muxer without being decoded.
+//
+// With --pipe, raw frames are read from stdin and written to stdout instead,
+// see FramePipe.h:
+//
+//     fakeartist-render --pipe rgba --size 640x360 [--fps 30] [--state ...]
+//     fakeartist-render --pipe y4m [--state ...]
+//
+// With --test-pattern, generated frames are sorted instead of a movie, the
+// same ones on every run (see SyntheticSource.h). Without --record, frames are
+// only sorted, which measures the sorter alone:
+//
+//     fakeartist-render --test-pattern photo --size 1920x1080 [--frames 300]
+//
+// With --replay, the frames and sorting states recorded by the app with
+// --record-state are sorted again, see StateRecording.h. --write-golden saves
+// hashes of the sorted frames and --check-golden compares them, see
+// GoldenHashes.h; neither needs --record:
+//
+//     fakeartist-render input.mp4 --replay session.states --check-golden session.golden
+//
+// --trace <file> writes where the time went as a Chrome trace when the render
+// is done, see Trace.hpp.
+//
+// --sort-dispatch <file> sorts segments with the backends calibrated for this
+// machine, calibrating them first if the file doesn't exist yet, see
+// sortdispatch.h; --calibrate-sort calibrates them again.
+//
+// With --jobs, the movie is split at keyframes and every chunk is rendered by
+// another fakeartist-render process (started with the hidden --chunk option),
+// then the parts are joined without re-encoding.
+
+#include <SFML/Graphics.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Demuxer.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
+
+#include "ChunkedRender.h"
+#include "FramePipe.h"
+#include "GoldenHashes.h"
+#include "prettysort.h"
+#include "RecordOptions.h"
+#include "sortdispatch.h"
+#include "SortTracing.h"
+#include "StateRecording.h"
+#include "StateScript.h"
+#include "SyntheticSource.h"
+#include "VideoFileSink.h"
+
+using namespace std;
+using namespace sf;
+
+// FFmpeg's default max_interleave_delta, in milliseconds
+static const Int64 MaxInterleaveDelay = 10000;
+
+// Keeps the last decoded frame in an image instead of a texture
+class FrameGrabber : public sfe::VideoStream::Delegate
+{
+public:
+    void didUpdateVideo(const sfe::VideoStream&, const Texture&)
+    {
+    }
+
+    void didDecodeVideo(const sfe::VideoStream& sender, const Uint8* pixels, Time time)
+    {
+        Vector2i size = sender.getFrameSize();
+        image.create(size.x, size.y, pixels);
+        timestamp = time;
+    }
+
+    bool usesVideoTexture() const
+    {
+        return false;
+    }
+
+    Image image;
+    Time timestamp;
+};
+
+// Copies the audio packets of the chunk being rendered to the output
+class AudioPassthrough : public sfe::Demuxer::PassthroughDelegate
+{
+public:
+    AudioPassthrough(VideoFileSink& sink_, const Chunk& chunk_, size_t streamCount_)
+        : sink(sink_)
+        , chunk(chunk_)
+        , streamCount(streamCount_)
+    {
+    }
+
+    void didReadPacket(const AVStream& stream, const AVPacket& packet)
+    {
+        int64_t timestamp = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+        if (timestamp == AV_NOPTS_VALUE)
+            return;
+
+        Int64 time = 1000 * timestamp * av_q2d(stream.time_base);
+        if (chunk.end >= 0 && time >= chunk.end)
+            pastEnd.insert(stream.index);
+        if (time < chunk.start || (chunk.end >= 0 && time >= chunk.end))
+            return;
+
+        sink.writePassthroughPacket(stream, packet);
+    }
+
+    // Tell whether every stream was read past the end of the chunk
+    bool isPastEnd() const
+    {
+        return pastEnd.size() >= streamCount;
+    }
+
+private:
+    VideoFileSink& sink;
+    Chunk chunk;
+    size_t streamCount;
+    set<int> pastEnd;
+};
+
+static void printUsage()
+{
+    cerr << "usage: fakeartist-render <input> --record <output> [options]" << endl
+         << "       fakeartist-render --pipe rgba|y4m [options] < input > output" << endl
+         << "  --script <path>     sorting state keyframes, see StateScript.h" << endl
+         << "  --state <settings>  fixed sorting state, like \"rows=1 mouseX=0.3\"" << endl
+         << "  --frames <count>    stop after this many frames" << endl
+         << "  --seed <number>     seed of the random walks (default 0)" << endl
+         << "  --jobs <count>      render chunks of the movie in parallel processes" << endl
+         << "  --no-audio          don't copy the soundtrack to video outputs" << endl
+         << "  --test-pattern <name> sort generated frames instead of a movie:" << endl
+         << "                      photo, bars, gradient or noise" << endl
+         << "  --size <w>x<h>      size of rgba frames read from stdin, or of test patterns" << endl
+         << "                      (default 1280x720)" << endl
+         << "  --fps <rate>        frame rate of rgba frames read from stdin or of test patterns" << endl
+         << "                      (default 30)" << endl
+         << "  --replay <path>     sort the frames and states recorded by the app's --record-state" << endl
+         << "  --write-golden <path> save hashes of the sorted frames" << endl
+         << "  --check-golden <path> compare the sorted frames to saved hashes" << endl
+         << "  --trace <path>      write where the time goes as a Chrome trace, see Trace.hpp" << endl
+         << "  --sort-dispatch <path> sort with the backends calibrated for this machine" << endl
+         << "  --calibrate-sort    calibrate them again, with --sort-dispatch" << endl
+         << "  --lossless, --gif-palettes, --gif-full-frames, see the app" << endl;
+}
+
+// "out.mp4" becomes "out.part3.mp4"
+static string partPath(const string& path, size_t index)
+{
+    ostringstream part;
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        dot = path.size();
+    part << path.substr(0, dot) << ".part" << index << path.substr(dot);
+    return part.str();
+}
+
+static int renderInChunks(const string& program, const string& input, const string& output,
+                          const vector<string>& forwardedArguments, unsigned jobs)
+{
+    Clock wallClock;
+
+    vector<Chunk> chunks;
+    if (!splitAtKeyframes(input, jobs, chunks))
+        return EXIT_FAILURE;
+
+    vector<vector<string>> commands;
+    vector<string> parts;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        parts.push_back(partPath(output, i));
+
+        vector<string> command;
+        command.push_back(program);
+        command.push_back(input);
+        command.push_back("--record");
+        command.push_back(parts.back());
+        command.push_back("--chunk");
+        command.push_back(to_string(chunks[i].start));
+        command.push_back(to_string(chunks[i].end));
+        command.insert(command.end(), forwardedArguments.begin(), forwardedArguments.end());
+        commands.push_back(command);
+    }
+
+    cout << "Rendering " << chunks.size() << " chunks" << endl;
+    bool ok = runProcesses(commands) && concatenateVideos(parts, output);
+
+    for (size_t i = 0; i < parts.size(); ++i)
+        remove(parts[i].c_str());
+
+    if (ok)
+        cout << "Rendered " << output << " in " << wallClock.getElapsedTime().asSeconds() << "s" << endl;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Sorts raw frames from stdin to stdout; nothing else goes to stdout
+static int renderPipe(FramePipe::Format format, const Vector2u& size, float frameRate,
+                      const StateScript& script, long maxFrames)
+{
+    FramePipe pipe(format, stdin, stdout);
+    if (!pipe.open(size, frameRate))
+        return EXIT_FAILURE;
+
+    // The only image, frames are read into it and sorted in place
+    Image image;
+    pipe.createImage(image);
+
+    Clock wallClock;
+    long frameCount = 0;
+    bool ok = true;
+
+    while (ok && (maxFrames < 0 || frameCount < maxFrames) && pipe.read(image)) {
+        State state = script.stateAt(pipe.getTimestamp().asSeconds());
+        prettySort(image, state);
+        ok = pipe.write(image);
+        frameCount++;
+    }
+    ok = fflush(stdout) == 0 && ok;
+
+    float seconds = wallClock.getElapsedTime().asSeconds();
+    cerr << "Sorted " << frameCount << " frames in " << seconds << "s ("
+         << (seconds > 0 ? frameCount / seconds : 0) << " fps)" << endl;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Sorts generated frames, and records them if there's a recording path
+static int renderTestPattern(SyntheticSource::Pattern pattern, const Vector2u& size, float frameRate,
+                             const StateScript& script, long maxFrames, const RecordOptions& recordOptions,
+                             GoldenHashes& golden)
+{
+    SyntheticSource source(size.x > 0 ? size : Vector2u(1280, 720), pattern, frameRate);
+    if (!source.open())
+        return EXIT_FAILURE;
+
+    unique_ptr<FrameSink> sink;
+    if (!recordOptions.path.empty()) {
+        sink = createFrameSink(recordOptions);
+        if (!sink->begin(source.getSize())) {
+            cerr << "Could not write " << recordOptions.path << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    Clock wallClock;
+    long frameCount = 0;
+    bool ok = true;
+    FrameView frame;
+
+    while (ok && frameCount < maxFrames && source.acquire(frame)) {
+        State state = script.stateAt(frame.timestamp.asSeconds());
+        prettySort(reinterpret_cast<Uint32*>(frame.pixels), frame.size, state);
+        golden.add(frame.pixels, frame.size);
+        if (sink)
+            ok = sink->write(frame.pixels, frame.timestamp);
+        source.release(frame);
+        frameCount++;
+    }
+
+    if (sink)
+        sink->end();
+    ok = golden.finish() && ok;
+
+    float seconds = wallClock.getElapsedTime().asSeconds();
+    cout << "Sorted " << frameCount << " " << SyntheticSource::getPatternName(pattern) << " frames of "
+         << source.getSize().x << "x" << source.getSize().y << " in " << seconds << "s ("
+         << (seconds > 0 ? frameCount / seconds : 0) << " fps)" << endl;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// "movies/clip.mp4" becomes "clip.mp4"
+static string fileName(const string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+// The seed of the random walks of a movie frame only depends on --seed and
+// the frame, so the workers of a chunked render sort their frames the same
+// as a single process going through the whole movie would
+static unsigned frameSeed(unsigned seed, Time timestamp, float frameRate)
+{
+    Int64 index = frameRate > 0 ? llround(timestamp.asSeconds() * frameRate) : timestamp.asMilliseconds();
+    return seed ^ static_cast<unsigned>(index * 2654435761u);
+}
+
+// Sorts the frames of a state recording again. The recording is the clock:
+// every recorded frame is decoded at the media time it had in the app and
+// sorted once with the state and seed it had, however long that takes, and
+// written with the time it was sorted at in the app.
+static int renderReplay(const string& input, const StateRecording& recording, const RecordOptions& recordOptions,
+                        GoldenHashes& golden)
+{
+    const vector<RecordedState>& frames = recording.getFrames();
+    if (frames.empty()) {
+        cerr << "No frames in the state recording" << endl;
+        return EXIT_FAILURE;
+    }
+    if (fileName(recording.getMedia()) != fileName(input))
+        cerr << "The states were recorded on " << recording.getMedia() << ", replaying them on " << input << endl;
+
+    FrameGrabber grabber;
+    shared_ptr<sfe::Timer> timer;
+    unique_ptr<sfe::Demuxer> demuxer;
+    shared_ptr<sfe::VideoStream> stream;
+    bool decoded = false;
+
+    unique_ptr<FrameSink> sink;
+    vector<Uint32> pixels;
+    Vector2u size;
+
+    Clock wallClock;
+    long missedFrames = 0;
+    bool ok = true;
+
+    for (size_t i = 0; ok && i < frames.size(); ++i) {
+        const RecordedState& frame = frames[i];
+
+        // Timestamps only go back when the app restarted the movie
+        if (!demuxer || (decoded && frame.mediaTime < grabber.timestamp)) {
+            stream = nullptr;
+            demuxer = nullptr;
+            timer = make_shared<sfe::Timer>();
+            try {
+                demuxer.reset(new sfe::Demuxer(input, timer, grabber));
+            } catch (std::runtime_error& e) {
+                cerr << "Could not open " << input << ": " << e.what() << endl;
+                return EXIT_FAILURE;
+            }
+
+            demuxer->selectFirstVideoStream();
+            stream = demuxer->getSelectedVideoStream();
+            if (!stream) {
+                cerr << "No video stream in " << input << endl;
+                return EXIT_FAILURE;
+            }
+
+            // Loops go on with the same timestamps as in the app
+            demuxer->setLooping(true);
+            decoded = false;
+        }
+
+        // The app may sort a frame several times or skip some, only the
+        // recorded ones are sorted
+        while (!decoded || grabber.timestamp < frame.mediaTime) {
+            if (!stream->decodeNextFrame())
+                break;
+            decoded = true;
+        }
+        if (!decoded) {
+            cerr << "No frames in " << input << endl;
+            return EXIT_FAILURE;
+        }
+        if (grabber.timestamp != frame.mediaTime)
+            missedFrames++;
+
+        if (pixels.empty()) {
+            size = grabber.image.getSize();
+            pixels.resize(size.x * size.y);
+            if (!recordOptions.path.empty()) {
+                sink = createFrameSink(recordOptions);
+                if (!sink->begin(size)) {
+                    cerr << "Could not write " << recordOptions.path << endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        // The decoded frame stays as it is, the next recorded frame may be the same one
+        memcpy(&pixels[0], grabber.image.getPixelsPtr(), pixels.size() * 4);
+
+        srand(frame.seed);
+        State state = frame.state;
+        prettySort(&pixels[0], size, state);
+
+        const Uint8* sorted = reinterpret_cast<const Uint8*>(&pixels[0]);
+        golden.add(sorted, size);
+        if (sink)
+            ok = sink->write(sorted, seconds(frame.state.time - frames[0].state.time));
+
+        if ((i + 1) % 100 == 0)
+            cout << i + 1 << " frames" << endl;
+    }
+
+    if (sink)
+        sink->end();
+    ok = golden.finish() && ok;
+
+    // The closest decoded frames were sorted instead, the output and the
+    // hashes are not the ones of the app
+    if (missedFrames > 0) {
+        cerr << missedFrames << " recorded frames were not found in " << input << endl;
+        ok = false;
+    }
+
+    float elapsed = wallClock.getElapsedTime().asSeconds();
+    cout << "Replayed " << frames.size() << " frames in " << elapsed << "s ("
+         << (elapsed > 0 ? frames.size() / elapsed : 0) << " fps)" << endl;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Writes the trace when the render is done, whichever way it ends
+struct TraceWriter
+{
+    ~TraceWriter()
+    {
+        if (path.empty())
+            return;
+        if (sfe::Trace::writeChromeTrace(path)) {
+            cerr << "Wrote trace to " << path << endl;
+        } else {
+            cerr << "Could not write trace to " << path << endl;
+        }
+    }
+
+    string path;
+};
+
+int main(int argc, char const** argv)
+{
+    string input;
+    RecordOptions recordOptions;
+    recordOptions.path = "";
+    StateScript script;
+    long maxFrames = -1;
+    unsigned seed = 0;
+    unsigned jobs = 1;
+    bool copyAudio = true;
+    bool pipe = false;
+    FramePipe::Format pipeFormat = FramePipe::Rgba;
+    Vector2u pipeSize;
+    float pipeFrameRate = 30;
+    bool testPattern = false;
+    SyntheticSource::Pattern pattern = SyntheticSource::Photo;
+    Chunk chunk = {0, -1};
+    string replayPath;
+    GoldenHashes::Mode goldenMode = GoldenHashes::Off;
+    string goldenPath;
+    TraceWriter traceWriter;
+    string sortDispatchPath;
+    bool calibrateSort = false;
+
+    // Arguments given as is to the workers of a chunked render
+    vector<string> forwardedArguments;
+
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        int first = i;
+        if (parseRecordOption(argc, argv, i, recordOptions)) {
+            if (argument != "--record")
+                forwardedArguments.insert(forwardedArguments.end(), argv + first, argv + i + 1);
+            continue;
+        } else if (argument == "--script" && i + 1 < argc) {
+            if (!script.loadFromFile(argv[++i]))
+                return EXIT_FAILURE;
+        } else if (argument == "--state" && i + 1 < argc) {
+            if (!script.addKeyframe(0, argv[++i])) {
+                cerr << "Invalid state " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--frames" && i + 1 < argc) {
+            maxFrames = atol(argv[++i]);
+        } else if (argument == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(atol(argv[++i]));
+        } else if (argument == "--pipe" && i + 1 < argc) {
+            string format = argv[++i];
+            if (format != "rgba" && format != "y4m") {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            pipe = true;
+            pipeFormat = format == "y4m" ? FramePipe::Y4m : FramePipe::Rgba;
+        } else if (argument == "--test-pattern" && i + 1 < argc) {
+            if (!SyntheticSource::patternFromName(argv[++i], pattern)) {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            testPattern = true;
+        } else if (argument == "--size" && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%u", &pipeSize.x, &pipeSize.y) != 2) {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+        } else if (argument == "--fps" && i + 1 < argc) {
+            pipeFrameRate = static_cast<float>(atof(argv[++i]));
+        } else if (argument == "--no-audio") {
+            copyAudio = false;
+        } else if (argument == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if ((argument == "--write-golden" || argument == "--check-golden") && i + 1 < argc) {
+            goldenMode = argument == "--write-golden" ? GoldenHashes::Write : GoldenHashes::Check;
+            goldenPath = argv[++i];
+        } else if (argument == "--trace" && i + 1 < argc) {
+            // Workers of a chunked render would all write to the same file
+            traceWriter.path = argv[++i];
+            continue;
+        } else if (argument == "--sort-dispatch" && i + 1 < argc) {
+            sortDispatchPath = argv[++i];
+        } else if (argument == "--calibrate-sort") {
+            // Workers load what the parent calibrated
+            calibrateSort = true;
+            continue;
+        } else if (argument == "--jobs" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(max(1L, atol(argv[++i])));
+            continue;
+        } else if (argument == "--chunk" && i + 2 < argc) {
+            chunk.start = atoll(argv[++i]);
+            chunk.end = atoll(argv[++i]);
+            continue;
+        } else if (input.empty() && argument[0] != '-') {
+            input = argument;
+            continue;
+        } else {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+        forwardedArguments.insert(forwardedArguments.end(), argv + first, argv + i + 1);
+    }
+
+    // Random walks must be the same from one run to the next, movie frames
+    // get their own seed, see frameSeed()
+    srand(seed);
+
+    if (!sortDispatchPath.empty()) {
+        useSortDispatch(sortDispatchPath, calibrateSort);
+    } else if (calibrateSort) {
+        cerr << "--calibrate-sort needs --sort-dispatch <path> to save the calibration" << endl;
+        return EXIT_FAILURE;
+    }
+
+    traceSortPasses();
+    if (!traceWriter.path.empty()) {
+        sfe::Trace::setThreadName("render");
+        sfe::Trace::setEnabled(true);
+    }
+
+    if (pipe)
+        return renderPipe(pipeFormat, pipeSize, pipeFrameRate, script, maxFrames);
+
+    GoldenHashes golden;
+    if (goldenMode != GoldenHashes::Off && !golden.open(goldenMode, goldenPath))
+        return EXIT_FAILURE;
+
+    if (testPattern)
+        return renderTestPattern(pattern, pipeSize, pipeFrameRate, script, maxFrames >= 0 ? maxFrames : 300, recordOptions, golden);
+
+    if (input.empty() || (recordOptions.path.empty() && !golden.isOpen())) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (!replayPath.empty()) {
+        StateRecording recording;
+        if (!recording.loadFromFile(replayPath))
+            return EXIT_FAILURE;
+        return renderReplay(input, recording, recordOptions, golden);
+    }
+
+    if (jobs > 1) {
+        if (maxFrames >= 0 || recordsGif(recordOptions) || golden.isOpen()) {
+            cerr << "--jobs needs a video output and can't be used with --frames or golden hashes" << endl;
+            return EXIT_FAILURE;
+        }
+        return renderInChunks(argv[0], input, recordOptions.path, forwardedArguments, jobs);
+    }
+
+    shared_ptr<sfe::Timer> timer = make_shared<sfe::Timer>();
+
+    FrameGrabber grabber;
+    unique_ptr<sfe::Demuxer> demuxer;
+    try {
+        demuxer.reset(new sfe::Demuxer(input, timer, grabber));
+    } catch (std::runtime_error& e) {
+        cerr << "Could not open " << input << ": " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    demuxer->selectFirstVideoStream();
+    shared_ptr<sfe::VideoStream> stream = demuxer->getSelectedVideoStream();
+    if (!stream) {
+        cerr << "No video stream in " << input << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Workers of a chunked render start on the chunk's keyframe
+    if (chunk.start > 0)
+        timer->seek(milliseconds(static_cast<Int32>(chunk.start)));
+
+    // Without --record, frames are only sorted and hashed
+    unique_ptr<FrameSink> sink;
+    if (!recordOptions.path.empty())
+        sink = createFrameSink(recordOptions);
+    unique_ptr<AudioPassthrough> audio;
+    VideoFileSink* videoSink = dynamic_cast<VideoFileSink*>(sink.get());
+    if (copyAudio && videoSink) {
+        vector<const AVStream*> audioStreams = demuxer->getIgnoredStreams(sfe::Audio);
+        for (size_t i = 0; i < audioStreams.size(); ++i)
+            videoSink->addPassthroughStream(*audioStreams[i]);
+
+        audio.reset(new AudioPassthrough(*videoSink, chunk, audioStreams.size()));
+        demuxer->setPassthroughDelegate(sfe::Audio, audio.get());
+    }
+
+    Vector2i frameSize = stream->getFrameSize();
+    float frameRate = stream->getFrameRate();
+    if (sink && !sink->begin(Vector2u(frameSize.x, frameSize.y))) {
+        cerr << "Could not write " << recordOptions.path << endl;
+        return EXIT_FAILURE;
+    }
+
+    Clock wallClock;
+    long frameCount = 0;
+    bool ok = true;
+
+    bool reachedChunkEnd = false;
+
+    while (ok && (maxFrames < 0 || frameCount < maxFrames) && stream->decodeNextFrame()) {
+        Int64 time = grabber.timestamp.asMilliseconds();
+        if (time < chunk.start)
+            continue;
+        if (chunk.end >= 0 && time >= chunk.end) {
+            reachedChunkEnd = true;
+            break;
+        }
+
+        State state = script.stateAt(grabber.timestamp.asSeconds());
+        srand(frameSeed(seed, grabber.timestamp, frameRate));
+        prettySort(grabber.image, state);
+        golden.add(grabber.image.getPixelsPtr(), grabber.image.getSize());
+        if (sink)
+            ok = sink->write(grabber.image.getPixelsPtr(), grabber.timestamp);
+        frameCount++;
+
+        if (frameCount % 100 == 0)
+            cout << frameCount << " frames" << endl;
+    }
+
+    // Audio of the chunk can be muxed after its last frame, read on until
+    // every audio stream went past the end, or for as long as FFmpeg lets
+    // streams drift apart when muxing
+    while (audio && reachedChunkEnd && !audio->isPastEnd()
+           && grabber.timestamp.asMilliseconds() < chunk.end + MaxInterleaveDelay && stream->decodeNextFrame()) {
+    }
+
+    demuxer->setPassthroughDelegate(sfe::Audio, nullptr);
+    if (sink)
+        sink->end();
+    ok = golden.finish() && ok;
+
+    float seconds = wallClock.getElapsedTime().asSeconds();
+    cout << "Rendered " << frameCount << " frames" << (sink ? " to " + recordOptions.path : "")
+         << " in " << seconds << "s (" << (seconds > 0 ? frameCount / seconds : 0) << " fps)" << endl;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+//
+//  main.cpp
+//  ringreader
+//
+//  Copyright (c) 2015 tinygayvoxels. All rights reserved.
+//
+
+// Reference consumer of the shared memory frame ring: follows the frames
+// published by `fakeartist --shm <name>` and reports what it got.
+//
+//     fakeartist-ringreader <name> [--frames N] [--dump frames.rgba]
+//
+// With --dump, every frame read is appended to a file as raw RGBA, which
+// can be checked with `ffplay -f rawvideo -pixel_format rgba -video_size WxH`.
+
+#include <SFML/System.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "SharedFrameRing.h"
+
+using namespace std;
+using namespace sf;
+
+int main(int argc, char const** argv)
+{
+    string name;
+    string dumpPath;
+    long maxFrames = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        string argument = argv[i];
+        if (argument == "--frames" && i + 1 < argc) {
+            maxFrames = atol(argv[++i]);
+        } else if (argument == "--dump" && i + 1 < argc) {
+            dumpPath = argv[++i];
+        } else if (name.empty() && argument[0] != '-') {
+            name = argument;
+        } else {
+            cerr << "usage: fakeartist-ringreader <name> [--frames N] [--dump frames.rgba]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (name.empty()) {
+        cerr << "usage: fakeartist-ringreader <name> [--frames N] [--dump frames.rgba]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    SharedFrameRingReader reader;
+    cout << "Waiting for " << name << endl;
+    while (!reader.open(name))
+        sleep(milliseconds(100));
+    cout << "Reading " << name << ", " << reader.getSlotCount() << " slots" << endl;
+
+    FILE* dump = nullptr;
+    if (!dumpPath.empty() && !(dump = fopen(dumpPath.c_str(), "wb"))) {
+        cerr << "Could not open " << dumpPath << endl;
+        return EXIT_FAILURE;
+    }
+
+    // Start with the latest frame, older ones may be long gone
+    Uint64 next = reader.getLatestSequence();
+    if (next == 0)
+        next = 1;
+
+    vector<Uint8> pixels;
+    Vector2u size;
+    Time timestamp;
+    long frameCount = 0;
+    long missedCount = 0;
+    long secondFrames = 0;
+    Clock secondClock;
+
+    while (maxFrames < 0 || frameCount < maxFrames) {
+        Uint64 latest = reader.getLatestSequence();
+        if (latest < next) {
+            sleep(milliseconds(1));
+        } else {
+            // Frames more than a ring behind were overwritten already
+            if (latest - next >= reader.getSlotCount()) {
+                Uint64 oldest = latest - reader.getSlotCount() + 1;
+                missedCount += oldest - next;
+                next = oldest;
+            }
+
+            if (reader.read(next, pixels, size, timestamp)) {
+                frameCount++;
+                secondFrames++;
+                if (dump)
+                    fwrite(&pixels[0], 1, pixels.size(), dump);
+            } else {
+                missedCount++;
+            }
+            next++;
+        }
+
+        if (secondClock.getElapsedTime() >= seconds(1)) {
+            cout << secondFrames << " fps, frame " << next - 1 << " " << size.x << "x" << size.y
+                 << " at " << timestamp.asSeconds() << "s, " << missedCount << " missed" << endl;
+            secondFrames = 0;
+            secondClock.restart();
+        }
+    }
+
+    if (dump)
+        fclose(dump);
+
+    cout << "Read " << frameCount << " frames, missed " << missedCount << endl;
+    return EXIT_SUCCESS;
+}